@@ -0,0 +1,76 @@
+#include <stdexcept>
+#include <zlib.h>
+#include "archive.hpp"
+
+archive_writer::archive_writer(const path& p, const bool compressed) : compressed(compressed), data(p, ios::binary), index(path(p.string() + ".idx")), offset(0)
+{
+	index << "name,offset,size,raw size\n";
+}
+
+void archive_writer::write(const string& name, const string& content)
+{
+	size_t size = content.size();
+	if (compressed)
+	{
+		// Deflate the content into a standalone gzip member.
+		z_stream zs = {};
+		deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+		string buffer(deflateBound(&zs, content.size()) + 32, '\0'); // deflateBound() excludes the gzip header and trailer.
+		zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+		zs.avail_in = static_cast<uInt>(content.size());
+		zs.next_out = reinterpret_cast<Bytef*>(&buffer[0]);
+		zs.avail_out = static_cast<uInt>(buffer.size());
+		const int rc = deflate(&zs, Z_FINISH);
+		size = zs.total_out;
+		deflateEnd(&zs);
+		if (rc != Z_STREAM_END) throw runtime_error("Failed to compress archive entry " + name);
+		data.write(buffer.data(), size);
+	}
+	else
+	{
+		data.write(content.data(), size);
+	}
+	index << name << ',' << offset << ',' << size << ',' << content.size() << '\n';
+	offset += size;
+}
+
+void archive_writer::close()
+{
+	data.close();
+	index.close();
+}
+
+archive_reader::archive_reader(const path& p) : data(p, ios::binary)
+{
+	boost::filesystem::ifstream ifs(path(p.string() + ".idx"));
+	string line;
+	getline(ifs, line); // name,offset,size,raw size
+	while (getline(ifs, line))
+	{
+		const size_t comma1 = line.find(',');
+		const size_t comma2 = line.find(',', comma1 + 1);
+		const size_t comma3 = line.find(',', comma2 + 1);
+		entries.push_back(archive_entry(line.substr(0, comma1), stoul(line.substr(comma1 + 1, comma2 - comma1 - 1)), stoul(line.substr(comma2 + 1, comma3 - comma2 - 1)), stoul(line.substr(comma3 + 1))));
+	}
+}
+
+string archive_reader::read(const archive_entry& e)
+{
+	string buffer(e.size, '\0');
+	data.seekg(e.offset);
+	data.read(&buffer[0], e.size);
+	if (e.size < 2 || buffer[0] != '\x1f' || buffer[1] != '\x8b') return buffer; // The entry lacks the gzip magic bytes, so it is stored uncompressed.
+
+	// Inflate the gzip member.
+	string content(e.raw_size, '\0');
+	z_stream zs = {};
+	inflateInit2(&zs, 15 + 16);
+	zs.next_in = reinterpret_cast<Bytef*>(&buffer[0]);
+	zs.avail_in = static_cast<uInt>(buffer.size());
+	zs.next_out = reinterpret_cast<Bytef*>(&content[0]);
+	zs.avail_out = static_cast<uInt>(content.size());
+	const int rc = inflate(&zs, Z_FINISH);
+	inflateEnd(&zs);
+	if (rc != Z_STREAM_END) throw runtime_error("Failed to decompress archive entry " + e.name);
+	return content;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef IGROW_ARCHIVE_HPP
+#define IGROW_ARCHIVE_HPP
+
+#include <vector>
+#include <string>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+using namespace std;
+using boost::filesystem::path;
+
+//! Represents an entry of the offset index of an archive.
+class archive_entry
+{
+public:
+	string name; //!< Name of the entry, e.g. 1.pdbqt.
+	size_t offset; //!< Offset of the entry in the archive.
+	size_t size; //!< Number of bytes the entry occupies in the archive.
+	size_t raw_size; //!< Number of bytes of the entry after decompression.
+
+	//! Constructs an archive entry.
+	explicit archive_entry(const string& name, const size_t offset, const size_t size, const size_t raw_size) : name(name), offset(offset), size(size), raw_size(raw_size) {}
+};
+
+//! Represents a writer of a packed archive, which concatenates many entries, e.g. the docked ligands of a generation, into one file and records their offsets in an index file.
+//! Uncompressed archives are multi-model PDBQT files. Compressed archives store every entry as a separate gzip member, so they can be both randomly accessed and decompressed as a whole by gzip.
+class archive_writer
+{
+public:
+	//! Opens an archive and its index, i.e. the archive path with .idx appended, for writing.
+	explicit archive_writer(const path& p, const bool compressed);
+
+	//! Appends an entry.
+	void write(const string& name, const string& content);
+
+	//! Flushes and closes the archive and its index.
+	void close();
+
+private:
+	const bool compressed; //!< True if entries are compressed.
+	boost::filesystem::ofstream data; //!< Archive stream.
+	boost::filesystem::ofstream index; //!< Index stream.
+	size_t offset; //!< Current offset in the archive.
+};
+
+//! Represents a reader of a packed archive.
+class archive_reader
+{
+public:
+	vector<archive_entry> entries; //!< Entries in the order they were written.
+
+	//! Opens an archive and parses its index.
+	explicit archive_reader(const path& p);
+
+	//! Returns the decompressed content of an entry.
+	string read(const archive_entry& e);
+
+private:
+	boost::filesystem::ifstream data; //!< Archive stream.
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include "philox.hpp"
+#include "benchmark.hpp"
+
+static const size_t max_placements = 1000; //!< Maximum number of random positions drawn to place an initial ligand in the box.
+
+//! Scores a ligand by a deterministic pseudo-random function of its atom types and frames, standing in for docking.
+//! Unlike a function of size, it does not drive the elites to the limits of the validator, so that the loop keeps creating children for many generations.
+static double synthetic_fe(const ligand& l)
+{
+	uint64_t h = l.num_rotatable_bonds;
+	for (const auto& a : l.atoms)
+	{
+		h = (h ^ a.ad) * 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return -4 - 8 * static_cast<double>(h % 1024) / 1023;
+}
+
+int benchmark(const path& fragment_folder, const validator& v, const grower::options& stages, const box* b, const size_t fragment_cache_capacity, const size_t num_elitists, const size_t num_additions, const size_t num_subtractions, const size_t num_crossovers, const size_t max_failures, const size_t seed, const size_t max_threads, const size_t num_generations)
+{
+	// Parse the fragments.
+	cout << "Parsing fragments in " << fragment_folder << endl;
+	vector<path> fragment_paths;
+	for (boost::filesystem::directory_iterator dir_iter(fragment_folder), end_dir_iter; dir_iter != end_dir_iter; ++dir_iter)
+	{
+		if (!is_regular_file(dir_iter->status())) continue;
+		fragment_paths.push_back(dir_iter->path());
+	}
+	sort(fragment_paths.begin(), fragment_paths.end()); // Directory iteration order is unspecified, so sort the fragments for reproducibility.
+	vector<ligand> fragments;
+	vector<ligand> initial;
+	for (size_t f = 0; f < fragment_paths.size(); ++f)
+	{
+		fragments.push_back(ligand(fragment_paths[f]));
+		fragments.back().id = ligand_id(ligand_id::fragment_generation, f);
+	}
+
+	// Form an initial generation of the fragments and of every fragment joined with the next one at their first mutable atoms. Like the initial generation of a real run, they need not be valid themselves, but the invalid ones are scored 0 so that they are the first to be replaced.
+	for (size_t i = 0; i < fragments.size(); ++i)
+	{
+		const ligand& l1 = fragments[i];
+		const ligand& l2 = fragments[(i + 1) % fragments.size()];
+		initial.push_back(l1);
+		initial.back().id = ligand_id(0, initial.size() - 1);
+		if (l1.addition_feasible() && l2.addition_feasible()) initial.push_back(ligand(ligand_id(0, initial.size()), l1, l2, 0, 0));
+	}
+	for (auto& l : initial)
+	{
+		l.fe = v(l) ? synthetic_fe(l) : 0;
+	}
+
+	// Place the initial ligands at random positions in the box of the receptor if any, drawing positions until a ligand passes the prefilter if requested, as the docked poses of a real initial generation lie in the box without clashing.
+	for (size_t i = 0; b && i < initial.size(); ++i)
+	{
+		ligand& l = initial[i];
+		array<double, 3> centroid = { 0, 0, 0 };
+		for (const auto& a : l.atoms)
+		{
+			for (size_t d = 0; d < 3; ++d) centroid[d] += a.coordinate[d] / l.atoms.size();
+		}
+		for (size_t attempt = 0; attempt < max_placements; ++attempt)
+		{
+			philox eng(seed, 0, i, attempt);
+			array<double, 3> position;
+			for (size_t d = 0; d < 3; ++d)
+			{
+				position[d] = uniform_real_distribution<double>(b->corner0[d], b->corner1[d])(eng);
+			}
+			for (auto& a : l.atoms)
+			{
+				for (size_t d = 0; d < 3; ++d) a.coordinate[d] += position[d] - centroid[d];
+			}
+			centroid = position;
+			if (!stages.pf || (*stages.pf)(l)) break;
+		}
+	}
+
+	if (initial.size() < num_elitists)
+	{
+		cerr << "Failed to construct initial generation because the fragment folder " << fragment_folder << " yields less than " << num_elitists << " initial ligands." << endl;
+		return 1;
+	}
+
+	// Sweep the number of threads in powers of 2, ending with max_threads.
+	vector<size_t> thread_counts;
+	for (size_t t = 1; t < max_threads; t <<= 1)
+	{
+		thread_counts.push_back(t);
+	}
+	thread_counts.push_back(max_threads);
+
+	cout << "Running " << num_generations << " generations of " << num_additions + num_subtractions + num_crossovers << " children with random seed " << seed << endl;
+	cout << "Threads | Generations | Children |  Failures |  Seconds | Children/s | Failures/s |  p50 ms |  p99 ms | Efficiency" << endl;
+	const auto flags = cout.flags();
+	const auto precision = cout.precision();
+	cout.setf(ios::fixed, ios::floatfield);
+	double base_rate = 0;
+	for (const size_t num_threads : thread_counts)
+	{
+		// Start every thread count with a cold fragment cache, whose misses are part of the creation phase of a real run.
+		io_service_pool io(num_threads);
+		fragment_cache fc(fragment_paths, fragment_cache_capacity);
+		const fragment_index fi(fc, v);
+		grower g(fc, fi, v, [](ligand& l)
+		{
+			return synthetic_fe(l);
+		}, num_elitists, num_additions, num_subtractions, num_crossovers, max_failures, seed, io, stages);
+		g.initialize(initial);
+
+		// Time the generations, collecting the latency of creating every child.
+		vector<double> latencies;
+		const auto start = std::chrono::steady_clock::now();
+		while (g.generation() < num_generations)
+		{
+			const bool completed = g.step();
+			latencies.insert(latencies.end(), g.creation_times().cbegin(), g.creation_times().cend());
+			if (!completed) break;
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Report the throughput, the latency percentiles and the efficiency relative to the first thread count.
+		sort(latencies.begin(), latencies.end());
+		const auto percentile = [&](const double q)
+		{
+			return latencies.empty() ? 0 : latencies[static_cast<size_t>(q * (latencies.size() - 1))] * 1e3;
+		};
+		const double rate = g.created() / seconds;
+		if (num_threads == thread_counts.front()) base_rate = rate;
+		cout << setw(7) << num_threads << "   "
+			<< setw(11) << g.generation() << "   "
+			<< setw(8) << g.created() << "   "
+			<< setw(9) << g.failures() << "   "
+			<< setprecision(3) << setw(8) << seconds << "   "
+			<< setprecision(1) << setw(10) << rate << "   "
+			<< setw(10) << g.failures() / seconds << "   "
+			<< setprecision(3) << setw(7) << percentile(0.5) << "   "
+			<< setw(7) << percentile(0.99) << "   "
+			<< setw(10) << rate / (base_rate * num_threads) << endl;
+		io.wait();
+	}
+	cout.flags(flags);
+	cout.precision(precision);
+	return 0;
+}
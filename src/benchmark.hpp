@@ -0,0 +1,15 @@
+#pragma once
+#ifndef IGROW_BENCHMARK_HPP
+#define IGROW_BENCHMARK_HPP
+
+#include "grower.hpp"
+
+//! Measures the scaling of the creation phase of igrow with the number of threads by running its generation loop on a fragment folder, starting from an initial generation of the fragments and joined pairs of them, with docking replaced by a deterministic synthetic score.
+//! Children are created by the given optional stages as in a real run, e.g. pre-screening, warm starting and prefiltering against a receptor, tabu search and diversity filtering, and addition samples the fragments through a cache of the given capacity, which starts cold for every thread count.
+//! If the stages score against a receptor, the initial ligands are placed at random positions in its box b that pass the prefilter if any, as the docked poses of a real initial generation do.
+//! The loop is run for num_generations generations, or until max_failures failures, on 1, 2, 4, ... up to max_threads threads, and a table of the generations completed, children and failures per second, the 50th and 99th percentiles of the latency of creating a child and the parallel efficiency relative to 1 thread is printed.
+//! Every thread count starts from the same elites and random streams, but the counts of children and failures need not agree across thread counts, as the failures are counted by all the threads together and the tabu memo is shared, both in the order the threads happen to reach them.
+//! @return 0 on success, or 1 if the fragments are too few to form the initial elites.
+int benchmark(const path& fragment_folder, const validator& v, const grower::options& stages, const box* b, const size_t fragment_cache_capacity, const size_t num_elitists, const size_t num_additions, const size_t num_subtractions, const size_t num_crossovers, const size_t max_failures, const size_t seed, const size_t max_threads, const size_t num_generations);
+
+#endif
@@ -0,0 +1,21 @@
+#include <cmath>
+#include "box.hpp"
+
+box::box(const array<double, 3>& center, const array<double, 3>& span, const double granularity) : center(center), span(span), granularity(granularity), granularity_inv(1 / granularity)
+{
+	for (size_t i = 0; i < 3; ++i)
+	{
+		num_probes[i] = static_cast<size_t>(ceil(span[i] * granularity_inv)) + 1;
+		corner0[i] = center[i] - 0.5 * span[i];
+		corner1[i] = corner0[i] + granularity * (num_probes[i] - 1);
+	}
+}
+
+bool box::within(const array<double, 3>& coordinate) const
+{
+	for (size_t i = 0; i < 3; ++i)
+	{
+		if (coordinate[i] < corner0[i] || corner1[i] < coordinate[i]) return false;
+	}
+	return true;
+}
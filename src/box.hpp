@@ -0,0 +1,33 @@
+#pragma once
+#ifndef IGROW_BOX_HPP
+#define IGROW_BOX_HPP
+
+#include <array>
+using namespace std;
+
+//! Represents the search space of idock, i.e. a cuboid partitioned into regularly spaced probes.
+class box
+{
+public:
+	array<double, 3> center; //!< Box center.
+	array<double, 3> span; //!< Box size.
+	array<double, 3> corner0; //!< Box corner with the smallest coordinate values.
+	array<double, 3> corner1; //!< Box corner with the largest coordinate values.
+	double granularity; //!< Distance between two adjacent probes.
+	double granularity_inv; //!< 1 / granularity.
+	array<size_t, 3> num_probes; //!< Number of probes along each dimension.
+
+	//! Constructs a box from its center, its size and the granularity of its probes.
+	explicit box(const array<double, 3>& center, const array<double, 3>& span, const double granularity);
+
+	//! Returns true if a coordinate is within the current box.
+	bool within(const array<double, 3>& coordinate) const;
+
+	//! Returns the total number of probes.
+	size_t num_probes_product() const
+	{
+		return num_probes[0] * num_probes[1] * num_probes[2];
+	}
+};
+
+#endif
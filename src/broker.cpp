@@ -0,0 +1,253 @@
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <iostream>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/filesystem/operations.hpp>
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+#include "broker.hpp"
+using namespace boost::asio;
+
+//! Returns the current time in seconds since the epoch of the system clock, which all processes on a node share.
+static double epoch_seconds()
+{
+	return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+string broker_job::request() const
+{
+	ostringstream ss;
+	ss.precision(17);
+	ss << client << '\t' << working_directory.string() << '\t' << config_path.string() << '\t' << seed << '\t' << input_folder.string() << '\t' << output_folder.string() << '\t' << log_path.string() << '\t' << deadline << '\n';
+	return ss.str();
+}
+
+unique_ptr<broker_job> broker_job::parse(const string& line)
+{
+	vector<string> fields;
+	for (size_t b = 0, e; b <= line.size(); b = e + 1)
+	{
+		e = line.find('\t', b);
+		if (e == string::npos) e = line.size();
+		fields.push_back(line.substr(b, e - b));
+	}
+	if (fields.size() != 8) throw runtime_error("Malformed docking request: " + line);
+	unique_ptr<broker_job> job(new broker_job);
+	job->client = fields[0];
+	job->working_directory = fields[1];
+	job->config_path = fields[2];
+	job->seed = stoul(fields[3]);
+	job->input_folder = fields[4];
+	job->output_folder = fields[5];
+	job->log_path = fields[6];
+	job->deadline = stod(fields[7]);
+	return job;
+}
+
+broker::broker(const path& socket_path, const path& idock_path, const size_t num_workers, const size_t num_cpus) : socket_path(socket_path), idock_path(idock_path), cpu_sets(num_workers), num_pending(0)
+{
+	// Split the CPUs into contiguous sets, one per worker, and share the CPUs round-robin if there are more workers than CPUs.
+	if (num_workers > num_cpus)
+	{
+		for (size_t w = 0; w < num_workers; ++w)
+		{
+			cpu_sets[w].push_back(w % num_cpus);
+		}
+		return;
+	}
+	for (size_t w = 0; w < num_workers; ++w)
+	{
+		for (size_t c = num_cpus * w / num_workers; c < num_cpus * (w + 1) / num_workers; ++c)
+		{
+			cpu_sets[w].push_back(c);
+		}
+	}
+}
+
+void broker::enqueue(unique_ptr<broker_job> job)
+{
+	lock_guard<mutex> guard(m);
+	auto& q = queues[job->client];
+	if (q.empty())
+	{
+		bool active = false;
+		double min_usage = 0;
+		for (const auto& c : queues)
+		{
+			if (c.second.empty()) continue;
+			const double u = usage[c.first];
+			if (!active || u < min_usage) min_usage = u;
+			active = true;
+		}
+		auto& u = usage[job->client];
+		if (active && u < min_usage) u = min_usage;
+	}
+	q.push_back(move(job));
+	++num_pending;
+	cv.notify_one();
+}
+
+void broker::work(const size_t w)
+{
+	const vector<size_t>& cpus = cpu_sets[w];
+	path last_config_path;
+	while (true)
+	{
+		// Take the next job of the least served client, preferring the receptor docked last among ties.
+		unique_ptr<broker_job> job;
+		{
+			unique_lock<mutex> lock(m);
+			cv.wait(lock, [&]()
+			{
+				return num_pending > 0;
+			});
+			auto best = queues.end();
+			for (auto c = queues.begin(); c != queues.end(); ++c)
+			{
+				if (c->second.empty()) continue;
+				if (best != queues.end())
+				{
+					const double u = usage[c->first], b = usage[best->first];
+					if (u > b || (u == b && (c->second.front()->config_path != last_config_path || best->second.front()->config_path == last_config_path))) continue;
+				}
+				best = c;
+			}
+			job = move(best->second.front());
+			best->second.pop_front();
+			--num_pending;
+		}
+
+		// Drop the job if its client has disconnected or its deadline has passed while it was pending.
+		double timeout = 0;
+		if (job->deadline > 0) timeout = job->deadline - epoch_seconds();
+		if (*job->cancelled || (job->deadline > 0 && timeout <= 0))
+		{
+			job->exit_code.set_value(docker::timed_out);
+			continue;
+		}
+
+		// Run the job for at most the time left before its deadline, reporting a failure to launch idock as a failed job rather than bringing the broker down.
+		const auto start = std::chrono::steady_clock::now();
+		int exit_code;
+		try
+		{
+			exit_code = docker(idock_path, job->config_path, job->seed, path(), job->working_directory)(job->input_folder, job->output_folder, job->log_path, cpus, timeout, job->cancelled.get());
+		}
+		catch (const std::exception& e)
+		{
+			cerr << "Worker " << w << " failed to run idock for client " << job->client << ": " << e.what() << endl;
+			exit_code = 1;
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		last_config_path = job->config_path;
+		{
+			lock_guard<mutex> guard(m);
+			usage[job->client] += seconds * cpus.size();
+		}
+		job->exit_code.set_value(exit_code);
+	}
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+void broker::run()
+{
+	// Replace a stale socket left by a previous broker.
+	boost::system::error_code ec;
+	boost::filesystem::remove(socket_path, ec);
+	io_service io;
+	local::stream_protocol::acceptor acceptor(io, local::stream_protocol::endpoint(socket_path.string()));
+
+	for (size_t w = 0; w < cpu_sets.size(); ++w)
+	{
+		thread([this, w]()
+		{
+			work(w);
+		}).detach();
+	}
+
+	// Serve every client connection on its own thread, which blocks until the job is done.
+	while (true)
+	{
+		auto s = make_shared<local::stream_protocol::socket>(io);
+		acceptor.accept(*s);
+		thread([this, s]()
+		{
+			try
+			{
+				boost::asio::streambuf buf;
+				read_until(*s, buf, '\n');
+				istream is(&buf);
+				string line;
+				getline(is, line);
+				auto job = broker_job::parse(line);
+				auto exit_code = job->exit_code.get_future();
+				const auto cancelled = job->cancelled;
+				enqueue(move(job));
+
+				// Wait for the job while watching the connection, which the client sends nothing more over, so that it is readable only once the client has disconnected.
+				while (exit_code.wait_for(std::chrono::milliseconds(100)) != future_status::ready)
+				{
+					pollfd p = { s->native_handle(), POLLIN, 0 };
+					char c;
+					if (::poll(&p, 1, 0) > 0 && ::recv(p.fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0)
+					{
+						*cancelled = true;
+						return;
+					}
+				}
+				write(*s, buffer(to_string(exit_code.get()) + '\n'));
+			}
+			catch (const std::exception& e)
+			{
+				cerr << e.what() << endl;
+			}
+		}).detach();
+	}
+}
+
+int broker::submit(const path& socket_path, const path& config_path, const size_t seed, const path& input_folder, const path& output_folder, const path& log_path, const double timeout)
+{
+	broker_job job;
+	job.client = to_string(getpid());
+	job.working_directory = boost::filesystem::current_path();
+	job.config_path = boost::filesystem::absolute(config_path);
+	job.seed = seed;
+	job.input_folder = boost::filesystem::absolute(input_folder);
+	job.output_folder = boost::filesystem::absolute(output_folder);
+	job.log_path = boost::filesystem::absolute(log_path);
+	job.deadline = timeout > 0 ? epoch_seconds() + timeout : 0;
+
+	io_service io;
+	local::stream_protocol::socket s(io);
+	s.connect(local::stream_protocol::endpoint(socket_path.string()));
+	write(s, buffer(job.request()));
+	boost::asio::streambuf buf;
+	read_until(s, buf, '\n');
+	istream is(&buf);
+	int exit_code;
+	if (!(is >> exit_code)) throw runtime_error("Malformed reply from docking broker at " + socket_path.string());
+	return exit_code;
+}
+
+#else
+
+void broker::run()
+{
+	throw runtime_error("Docking broker requires Unix domain sockets, which are not supported on this platform");
+}
+
+int broker::submit(const path& socket_path, const path&, const size_t, const path&, const path&, const path&, const double)
+{
+	throw runtime_error("Docking broker at " + socket_path.string() + " requires Unix domain sockets, which are not supported on this platform");
+}
+
+#endif
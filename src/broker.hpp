@@ -0,0 +1,74 @@
+#pragma once
+#ifndef IGROW_BROKER_HPP
+#define IGROW_BROKER_HPP
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <condition_variable>
+#include "docker.hpp"
+
+//! Represents a docking job submitted to a broker by a client.
+class broker_job
+{
+public:
+	string client; //!< Identity of the submitting client, i.e. its host process id.
+	path working_directory; //!< Working directory of the client, against which idock resolves relative paths in the configuration file.
+	path config_path; //!< Absolute path to the idock configuration file, which determines the receptor.
+	size_t seed; //!< Random seed passed to idock.
+	path input_folder; //!< Absolute path to the input folder.
+	path output_folder; //!< Absolute path to the output folder.
+	path log_path; //!< Absolute path to the idock log.
+	double deadline; //!< Wall-clock deadline of the job in seconds since the epoch of the system clock, which the client and the broker on the same node share, 0 for no deadline.
+	shared_ptr<atomic<bool>> cancelled; //!< Raised when the client disconnects, so that the job is dropped if pending or killed if running.
+	promise<int> exit_code; //!< Exit code of idock, or docker::timed_out.
+
+	//! Constructs an empty job.
+	explicit broker_job() : seed(0), deadline(0), cancelled(make_shared<atomic<bool>>(false)) {}
+
+	//! Serializes the job as a single request line.
+	string request() const;
+
+	//! Parses a job from a request line.
+	//! @exception runtime_error Thrown when the line is malformed.
+	static unique_ptr<broker_job> parse(const string& line);
+};
+
+//! Represents a docking broker, a local daemon that owns a fixed pool of idock workers pinned to disjoint CPU sets and serves docking jobs submitted by any number of igrow clients over a Unix domain socket.
+//! Pending jobs are queued per client, and an idle worker takes the next job of the client that has consumed the fewest CPU seconds, so that concurrent runs share the node fairly regardless of how many jobs each submits.
+//! A job runs for at most the time left before its deadline, so that waiting in the queue counts against it, and a job whose client has disconnected is dropped or killed, so that it no longer consumes the share of that client.
+//! Among equally served clients a worker prefers one whose job uses the receptor it docked last, so that the receptor and its idock grid stay warm in the page cache of that worker's CPUs.
+class broker
+{
+public:
+	//! Constructs a broker of num_workers idock workers over num_cpus CPUs, listening on a Unix domain socket at socket_path.
+	explicit broker(const path& socket_path, const path& idock_path, const size_t num_workers, const size_t num_cpus);
+
+	//! Serves clients until the process is killed.
+	void run();
+
+	//! Submits a docking job to the broker listening at socket_path on behalf of the current process, and waits for its completion. The timeout in seconds, 0 for no limit, counts from the submission.
+	//! @return The exit code of idock, or docker::timed_out if it has been killed or its deadline has passed before it started.
+	static int submit(const path& socket_path, const path& config_path, const size_t seed, const path& input_folder, const path& output_folder, const path& log_path, const double timeout);
+
+private:
+	const path socket_path; //!< Path to the Unix domain socket.
+	const path idock_path; //!< Path to the idock executable.
+	vector<vector<size_t>> cpu_sets; //!< CPUs assigned to every worker.
+	mutex m; //!< Mutex protecting the queues.
+	condition_variable cv; //!< Signals workers of pending jobs.
+	map<string, deque<unique_ptr<broker_job>>> queues; //!< Pending jobs per client.
+	map<string, double> usage; //!< Consumed CPU seconds per client.
+	size_t num_pending; //!< Number of pending jobs across all clients.
+
+	//! Enqueues a job, raising the usage of a client that becomes active to the minimum usage of the other active clients, so that it cannot starve them by the service it did not ask for while idle.
+	void enqueue(unique_ptr<broker_job> job);
+
+	//! Runs jobs on a worker pinned to the w-th CPU set.
+	void work(const size_t w);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <algorithm>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+#include "budget.hpp"
+
+//! Returns the CPU seconds consumed by the current process and, except on Windows, by its terminated and waited-for child processes, i.e. the idock processes it has run.
+static double process_cpu_seconds()
+{
+#if defined(_WIN32)
+	FILETIME creation, exit, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	const auto seconds = [](const FILETIME& t)
+	{
+		return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 1e-7;
+	};
+	return seconds(kernel) + seconds(user);
+#else
+	double s = 0;
+	for (const int who : { RUSAGE_SELF, RUSAGE_CHILDREN })
+	{
+		rusage usage;
+		getrusage(who, &usage);
+		s += usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+	}
+	return s;
+#endif
+}
+
+budget::budget(const double max_seconds, const size_t max_dockings, const double max_cpu_seconds, const size_t patience, const double tolerance) :
+	max_seconds(max_seconds), max_dockings(max_dockings), max_cpu_seconds(max_cpu_seconds), patience(patience), tolerance(tolerance),
+	start_time(chrono::steady_clock::now()), start_cpu_seconds(process_cpu_seconds()), step_time(start_time), step_cpu_seconds(start_cpu_seconds),
+	num_dockings(0), docking_seconds(0), docking_cpu_seconds(0), num_generations(0), best_fe(0), num_stagnant(0)
+{
+}
+
+double budget::seconds() const
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+}
+
+double budget::cpu_seconds() const
+{
+	return process_cpu_seconds() - start_cpu_seconds;
+}
+
+size_t budget::affordable(const size_t num_pending, const double spent, const double spent_docking, const double limit) const
+{
+	if (limit <= 0) return num_pending;
+	if (spent >= limit) return 0;
+	if (!num_dockings || !num_generations) return num_pending;
+
+	// Reserve the average overhead of a generation besides docking, and spend the rest at the average cost of a docking.
+	const double remaining = limit - spent - (spent - spent_docking) / num_generations;
+	if (remaining <= 0) return 0;
+	const double cost = spent_docking / num_dockings;
+	if (cost <= 0) return num_pending;
+	return static_cast<size_t>(min<double>(floor(remaining / cost), num_pending));
+}
+
+size_t budget::affordable(const size_t num_pending) const
+{
+	size_t n = num_pending;
+	if (max_dockings) n = min(n, max_dockings - min(num_dockings, max_dockings));
+	n = affordable(n, seconds(), docking_seconds, max_seconds);
+	n = affordable(n, cpu_seconds(), docking_cpu_seconds, max_cpu_seconds);
+	return n;
+}
+
+chrono::steady_clock::time_point budget::deadline() const
+{
+	if (max_seconds <= 0) return chrono::steady_clock::time_point::max();
+	return start_time + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(max_seconds));
+}
+
+void budget::start()
+{
+	step_time = chrono::steady_clock::now();
+	step_cpu_seconds = process_cpu_seconds();
+}
+
+void budget::charge(const size_t num_docked)
+{
+	num_dockings += num_docked;
+	docking_seconds += chrono::duration<double>(chrono::steady_clock::now() - step_time).count();
+	docking_cpu_seconds += process_cpu_seconds() - step_cpu_seconds;
+}
+
+void budget::complete(const double avg_fe)
+{
+	if (!num_generations++ || avg_fe < best_fe - tolerance)
+	{
+		best_fe = avg_fe;
+		num_stagnant = 0;
+	}
+	else
+	{
+		++num_stagnant;
+	}
+}
+
+string budget::exhausted() const
+{
+	ostringstream ss;
+	if (max_dockings && num_dockings >= max_dockings) ss << "docking budget of " << max_dockings << " dockings";
+	else if (!affordable(1, seconds(), docking_seconds, max_seconds)) ss << "wall-clock budget of " << max_seconds << " seconds";
+	else if (!affordable(1, cpu_seconds(), docking_cpu_seconds, max_cpu_seconds)) ss << "CPU budget of " << max_cpu_seconds << " CPU seconds";
+	return ss.str();
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef IGROW_BUDGET_HPP
+#define IGROW_BUDGET_HPP
+
+#include <string>
+#include <chrono>
+using namespace std;
+
+//! Represents the compute budget of a run, i.e. limits on its wall-clock time, its number of dockings and its CPU time, together with a detector of the stagnation of the elites.
+//! The cost of a docking and the overhead of a generation are learned from the generations run so far, so that a generation can be cut short to the children the remaining budget affords.
+class budget
+{
+public:
+	const double max_seconds; //!< Maximum wall-clock seconds of the run, 0 for no limit.
+	const size_t max_dockings; //!< Maximum number of dockings, 0 for no limit.
+	const double max_cpu_seconds; //!< Maximum CPU seconds of igrow and the idock processes it runs, 0 for no limit. Brokered idock jobs run in the broker and are not counted.
+	const size_t patience; //!< Number of consecutive generations without improvement of the average elite free energy after which the run has converged, 0 to disable.
+	const double tolerance; //!< Minimum decrease in kcal/mol of the average elite free energy counted as an improvement.
+
+	//! Constructs a budget and starts its clocks.
+	explicit budget(const double max_seconds, const size_t max_dockings, const double max_cpu_seconds, const size_t patience, const double tolerance);
+
+	//! Returns how many of num_pending dockings the remaining budget affords, reserving the overhead of a generation besides docking. None is afforded by a time or CPU limit that has expired, and otherwise all of them are afforded by it until a docking has been observed.
+	size_t affordable(const size_t num_pending) const;
+
+	//! Returns the time at which the wall-clock limit expires, beyond which docking jobs are killed, or the maximum time point if there is no limit.
+	std::chrono::steady_clock::time_point deadline() const;
+
+	//! Starts a docking step.
+	void start();
+
+	//! Charges the docking step started last by its number of dockings, its wall-clock seconds and its CPU seconds.
+	void charge(const size_t num_docked);
+
+	//! Completes a generation given the average free energy of its elites.
+	void complete(const double avg_fe);
+
+	//! Returns a description of the limit exhausted, i.e. one that affords no more docking, or an empty string.
+	string exhausted() const;
+
+	//! Returns true if the average elite free energy has not improved for patience generations.
+	bool converged() const
+	{
+		return patience && num_stagnant >= patience;
+	}
+
+private:
+	const std::chrono::steady_clock::time_point start_time; //!< Start of the run.
+	const double start_cpu_seconds; //!< CPU seconds at the start of the run.
+	std::chrono::steady_clock::time_point step_time; //!< Start of the current docking step.
+	double step_cpu_seconds; //!< CPU seconds at the start of the current docking step.
+	size_t num_dockings; //!< Number of dockings charged.
+	double docking_seconds; //!< Wall-clock seconds charged to dockings.
+	double docking_cpu_seconds; //!< CPU seconds charged to dockings.
+	size_t num_generations; //!< Number of generations completed.
+	double best_fe; //!< Best average elite free energy improved upon by at least tolerance.
+	size_t num_stagnant; //!< Number of consecutive generations without improvement.
+
+	//! Returns the wall-clock seconds elapsed since the start of the run.
+	double seconds() const;
+
+	//! Returns the CPU seconds consumed since the start of the run.
+	double cpu_seconds() const;
+
+	//! Returns how many of num_pending dockings fit into the remaining amount of a resource, given the amount spent, the amount spent on dockings, and a limit.
+	size_t affordable(const size_t num_pending, const double spent, const double spent_docking, const double limit) const;
+};
+
+#endif
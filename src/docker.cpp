@@ -0,0 +1,105 @@
+#include <thread>
+#include <chrono>
+#include <boost/process.hpp>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#if defined(BOOST_POSIX_API)
+#include <unistd.h>
+#endif
+#include "docker.hpp"
+#include "broker.hpp"
+using namespace boost::process;
+using namespace boost::process::initializers;
+
+const int docker::timed_out = -1;
+
+docker::docker(const path& idock_path, const path& config_path, const size_t seed, const path& broker_path, const path& working_directory) : idock_path(idock_path), broker_path(broker_path), working_directory(working_directory), config_path(config_path), seed(seed), args(11)
+{
+	args[0] = idock_path.string(); // By convention the first argument is the program itself.
+	args[1] = "--input_folder";
+	args[3] = "--output_folder";
+	args[5] = "--log";
+	args[7] = "--seed";
+	args[8] = to_string(seed);
+	args[9] = "--config";
+	args[10] = config_path.string();
+}
+
+int docker::operator()(const path& input_folder, const path& output_folder, const path& log_path) const
+{
+	return (*this)(input_folder, output_folder, log_path, vector<size_t>(), 0);
+}
+
+//! Waits for a child process to exit within a timeout in seconds, killing it when the timeout expires or, on POSIX, when the cancellation flag is raised. A timeout of 0 waits without a limit.
+static int wait_for_exit(const child& c, const double timeout, const atomic<bool>* cancelled)
+{
+#if defined(BOOST_POSIX_API)
+	// Reap the child by waitpid(2) in every case, as wait_for_exit of Boost.Process throws when the child is killed by a signal, which is reported as a non-zero status instead.
+	if (timeout <= 0 && !cancelled)
+	{
+		int status;
+		while (::waitpid(c.pid, &status, 0) == -1)
+		{
+			if (errno != EINTR) BOOST_PROCESS_THROW_LAST_SYSTEM_ERROR("waitpid(2) failed");
+		}
+		return status;
+	}
+	const auto deadline = timeout > 0 ? chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout)) : chrono::steady_clock::time_point::max();
+	// Poll with exponential backoff, so that short jobs are reaped promptly and long ones cost few wakeups.
+	for (auto interval = chrono::milliseconds(1); true; interval = min(interval * 2, chrono::milliseconds(100)))
+	{
+		int status;
+		const pid_t r = ::waitpid(c.pid, &status, WNOHANG);
+		if (r == c.pid) return status;
+		if (r == -1 && errno != EINTR) BOOST_PROCESS_THROW_LAST_SYSTEM_ERROR("waitpid(2) failed");
+		if (chrono::steady_clock::now() >= deadline || (cancelled && *cancelled)) break;
+		this_thread::sleep_for(interval);
+	}
+	terminate(c);
+	int status;
+	while (::waitpid(c.pid, &status, 0) == -1 && errno == EINTR);
+#else
+	if (timeout <= 0) return wait_for_exit(c);
+	const auto deadline = chrono::steady_clock::now() + chrono::duration<double>(timeout);
+	const auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+	if (::WaitForSingleObject(c.proc_info.hProcess, static_cast<DWORD>(max<long long>(remaining, 0))) != WAIT_TIMEOUT) return wait_for_exit(c);
+	terminate(c);
+	wait_for_exit(c);
+#endif
+	return docker::timed_out;
+}
+
+int docker::operator()(const path& input_folder, const path& output_folder, const path& log_path, const vector<size_t>& cpus, const double timeout, const atomic<bool>* cancelled) const
+{
+	if (!broker_path.empty()) return broker::submit(broker_path, config_path, seed, input_folder, output_folder, log_path, timeout);
+	vector<string> a(args);
+	a[2] = input_folder.string();
+	a[4] = output_folder.string();
+	a[6] = log_path.string();
+	if (!cpus.empty())
+	{
+		a.push_back("--threads");
+		a.push_back(to_string(cpus.size()));
+	}
+#if defined(BOOST_POSIX_API)
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (const size_t cpu : cpus)
+	{
+		CPU_SET(cpu, &set);
+	}
+#endif
+	// Set the affinity and the working directory in the forked child before it executes idock, so that idock and all its threads inherit them.
+	return wait_for_exit(execute(run_exe(idock_path), set_args(a), throw_on_error(), on_exec_setup([&](executor&)
+	{
+#if defined(__linux__)
+		if (!cpus.empty()) sched_setaffinity(0, sizeof(set), &set);
+#endif
+		if (!working_directory.empty() && chdir(working_directory.c_str())) _exit(EXIT_FAILURE);
+	})), timeout, cancelled);
+#else
+	return wait_for_exit(execute(run_exe(idock_path), set_args(a), throw_on_error()), timeout, cancelled);
+#endif
+}
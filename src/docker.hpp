@@ -0,0 +1,39 @@
+#pragma once
+#ifndef IGROW_DOCKER_HPP
+#define IGROW_DOCKER_HPP
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <boost/filesystem/path.hpp>
+using namespace std;
+using boost::filesystem::path;
+
+//! Represents the backend docking engine, i.e. an idock executable together with its configuration.
+class docker
+{
+public:
+	static const int timed_out; //!< Exit code reported for a killed idock process.
+	const path idock_path; //!< Path to the idock executable.
+	const path broker_path; //!< Path to the Unix domain socket of a docking broker that runs idock on behalf of this process, or empty to run idock directly.
+	const path working_directory; //!< Working directory of idock, against which relative paths in the configuration file are resolved, or empty to inherit that of this process. Only honored on POSIX.
+
+	//! Constructs a docker given the idock executable, the idock configuration file, the random seed, and optionally the socket of a docking broker and the working directory of idock.
+	explicit docker(const path& idock_path, const path& config_path, const size_t seed, const path& broker_path = path(), const path& working_directory = path());
+
+	//! Docks every ligand in the input folder and writes the docked ligands into the output folder. Returns the exit code of idock.
+	int operator()(const path& input_folder, const path& output_folder, const path& log_path) const;
+
+	//! Docks every ligand in the input folder by an idock process pinned to a set of CPUs, with as many idock threads as CPUs unless the set is empty. The CPU set is only honored on Linux.
+	//! If a broker is used, the job is submitted to it instead and runs on the CPU set of the broker's worker.
+	//! The process is killed if it runs longer than the timeout in seconds, unless the timeout is 0, or once the cancellation flag, if given, is raised. The cancellation flag is only honored on POSIX and ignored by brokered jobs.
+	//! @return The exit code of idock, or timed_out if it has been killed.
+	int operator()(const path& input_folder, const path& output_folder, const path& log_path, const vector<size_t>& cpus, const double timeout, const atomic<bool>* cancelled = nullptr) const;
+
+private:
+	const path config_path; //!< Path to the idock configuration file.
+	const size_t seed; //!< Random seed passed to idock.
+	vector<string> args; //!< Arguments to idock, with the folders and the log to be filled in per invocation.
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include "archive.hpp"
+
+//! Lists the entries of a packed generation archive written by igrow, or extracts the given entries to the standard output.
+int main(int argc, char* argv[])
+{
+	if (argc == 1)
+	{
+		cout << "Usage: igrow-extract <archive> [entry ...]" << endl;
+		cout << "       igrow-extract <archive>:<entry>" << endl;
+		cout << "Lists the entries of an archive, or extracts the given entries, e.g. 1.pdbqt, to the standard output. Ligands packed into archives are logged by igrow as <archive>:<entry>, e.g. output/3.pdbqt.gz:7.pdbqt." << endl;
+		return 0;
+	}
+
+	try
+	{
+		// Split an entry logged by igrow into its archive and its name.
+		string archive_path = argv[1];
+		vector<string> names(argv + 2, argv + argc);
+		if (names.empty() && !boost::filesystem::exists(archive_path))
+		{
+			const size_t colon = archive_path.rfind(':');
+			if (colon != string::npos)
+			{
+				names.push_back(archive_path.substr(colon + 1));
+				archive_path.resize(colon);
+			}
+		}
+		if (!boost::filesystem::exists(archive_path))
+		{
+			cerr << "Archive " << archive_path << " does not exist" << endl;
+			return 1;
+		}
+		archive_reader r(archive_path);
+
+		// List the entries if none is given.
+		if (names.empty())
+		{
+			for (const auto& e : r.entries)
+			{
+				cout << e.name << ',' << e.offset << ',' << e.size << ',' << e.raw_size << '\n';
+			}
+			return 0;
+		}
+
+		// Extract the given entries.
+		for (const auto& name : names)
+		{
+			const auto e = find_if(r.entries.cbegin(), r.entries.cend(), [&](const archive_entry& e)
+			{
+				return e.name == name;
+			});
+			if (e == r.entries.cend())
+			{
+				cerr << "Entry " << name << " does not exist in archive " << archive_path << endl;
+				return 1;
+			}
+			cout << r.read(*e);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include "safe_counter.hpp"
+#include "fingerprint.hpp"
+
+//! Mixes the bits of a 64-bit value, as in the finalizer of SplitMix64.
+static uint64_t mix(uint64_t h)
+{
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	return h ^ (h >> 31);
+}
+
+//! Hashes a feature consisting of a kind and up to three values.
+static uint64_t feature(const uint64_t kind, const uint64_t v0, const uint64_t v1 = 0, const uint64_t v2 = 0)
+{
+	return mix(mix(mix(mix(kind) ^ v0) ^ v1) ^ v2);
+}
+
+fingerprint::fingerprint(const ligand& l) : num_bits(0)
+{
+	words.fill(0);
+
+	// Find the heavy atoms, their frames and their bonded heavy neighbors.
+	vector<size_t> heavy, frame_of(l.num_atoms);
+	heavy.reserve(l.num_heavy_atoms);
+	for (size_t k = 0; k < l.frames.size(); ++k)
+	{
+		for (size_t i = l.frames[k].begin; i < l.frames[k].end; ++i)
+		{
+			frame_of[i] = k;
+		}
+	}
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		if (!l.atoms[i].is_hydrogen()) heavy.push_back(i);
+	}
+	vector<vector<size_t>> neighbors(heavy.size());
+	vector<size_t> num_hydrogens(heavy.size());
+	for (size_t p = 0; p < heavy.size(); ++p)
+	{
+		const atom& a = l.atoms[heavy[p]];
+		for (size_t q = p + 1; q < heavy.size(); ++q)
+		{
+			if (!a.is_neighbor(l.atoms[heavy[q]])) continue;
+			neighbors[p].push_back(q);
+			neighbors[q].push_back(p);
+		}
+		for (size_t i = 0; i < l.num_atoms; ++i)
+		{
+			if (l.atoms[i].is_hydrogen() && a.is_neighbor(l.atoms[i])) ++num_hydrogens[p];
+		}
+	}
+
+	for (size_t p = 0; p < heavy.size(); ++p)
+	{
+		const size_t ad = l.atoms[heavy[p]].ad;
+
+		// Atom environment: type, heavy degree and number of attached hydrogens.
+		set(feature(1, ad, neighbors[p].size(), num_hydrogens[p]));
+
+		for (size_t x = 0; x < neighbors[p].size(); ++x)
+		{
+			const size_t q = neighbors[p][x];
+			const size_t adq = l.atoms[heavy[q]].ad;
+
+			// Bond: the two types and whether the bond is rotatable, i.e. it connects two frames. Each bond is visited once.
+			if (p < q) set(feature(2, min(ad, adq), max(ad, adq), frame_of[heavy[p]] != frame_of[heavy[q]]));
+
+			// Angle: the central type and the two terminal types.
+			for (size_t y = x + 1; y < neighbors[p].size(); ++y)
+			{
+				const size_t adr = l.atoms[heavy[neighbors[p][y]]].ad;
+				set(feature(3, ad, min(adq, adr), max(adq, adr)));
+			}
+		}
+	}
+
+	// Frame topology: the numbers of heavy atoms and branches of each frame, and the total number of rotatable bonds.
+	for (size_t k = 0; k < l.frames.size(); ++k)
+	{
+		const frame& f = l.frames[k];
+		size_t num_frame_heavy_atoms = 0;
+		for (size_t i = f.begin; i < f.end; ++i)
+		{
+			if (!l.atoms[i].is_hydrogen()) ++num_frame_heavy_atoms;
+		}
+		set(feature(4, num_frame_heavy_atoms, l.num_branches(k)));
+	}
+	set(feature(5, l.num_rotatable_bonds));
+}
+
+void fingerprint::set(const uint64_t h)
+{
+	const size_t b = h % (num_words * 64);
+	uint64_t& w = words[b >> 6];
+	const uint64_t m = 1ULL << (b & 63);
+	if (w & m) return;
+	w |= m;
+	++num_bits;
+}
+
+void similarity_matrix(const vector<fingerprint>& rows, const vector<fingerprint>& cols, float* const out, io_service_pool& io)
+{
+	const size_t tile_size = 64;
+	const size_t num_rows = rows.size(), num_cols = cols.size();
+	const size_t num_tiles = (num_rows + tile_size - 1) / tile_size;
+	safe_counter<size_t> cnt;
+	cnt.init(num_tiles);
+	for (size_t t = 0; t < num_tiles; ++t)
+	{
+		io.post([&, t]()
+		{
+			const size_t row_end = min((t + 1) * tile_size, num_rows);
+			for (size_t col = 0; col < num_cols; ++col)
+			{
+				const fingerprint& c = cols[col];
+				for (size_t row = t * tile_size; row < row_end; ++row)
+				{
+					out[row * num_cols + col] = static_cast<float>(rows[row].tanimoto(c));
+				}
+			}
+			cnt.increment();
+		});
+	}
+	cnt.wait();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef IGROW_FINGERPRINT_HPP
+#define IGROW_FINGERPRINT_HPP
+
+#include <cstdint>
+#include <array>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "io_service_pool.hpp"
+#include "ligand.hpp"
+
+//! Returns the number of set bits of a 64-bit word.
+//! With hardware popcount, e.g. -mpopcnt or -march=native, this is a single instruction. Otherwise the SWAR bit-counting formula is used, which compilers vectorize across the words of a fingerprint.
+inline size_t popcount(uint64_t w)
+{
+#if defined(__POPCNT__)
+	return __builtin_popcountll(w);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return __popcnt64(w);
+#else
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (w * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+//! Represents a compact, hashed bit-vector fingerprint of a ligand, derived from its AutoDock4 atom types, covalent bonds and frame topology.
+class fingerprint
+{
+public:
+	static const size_t num_words = 16; //!< Number of 64-bit words, i.e. 1024 bits.
+	array<uint64_t, num_words> words; //!< Bits.
+	size_t num_bits; //!< Number of set bits.
+
+	//! Constructs an empty fingerprint.
+	explicit fingerprint() : num_bits(0)
+	{
+		words.fill(0);
+	}
+
+	//! Constructs the fingerprint of a ligand from its heavy atoms and their bonds, angles and frames.
+	explicit fingerprint(const ligand& l);
+
+	//! Returns the Tanimoto similarity to another fingerprint, i.e. the number of common bits divided by the number of bits set in either.
+	double tanimoto(const fingerprint& f) const
+	{
+		size_t c = 0;
+		for (size_t i = 0; i < num_words; ++i)
+		{
+			c += popcount(words[i] & f.words[i]);
+		}
+		const size_t u = num_bits + f.num_bits - c;
+		return u ? static_cast<double>(c) / u : 1;
+	}
+
+private:
+	//! Sets the bit addressed by a feature hash.
+	void set(const uint64_t h);
+};
+
+//! Computes the Tanimoto similarities of every row fingerprint against every column fingerprint in parallel, writing them in row-major order.
+//! The rows are processed in tiles, so that a tile of rows is compared against each column while the fingerprints of the tile stay in cache.
+void similarity_matrix(const vector<fingerprint>& rows, const vector<fingerprint>& cols, float* const out, io_service_pool& io);
+
+#endif
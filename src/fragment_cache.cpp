@@ -0,0 +1,88 @@
+#include "fragment_cache.hpp"
+
+//! Returns the estimated number of bytes occupied by a ligand, including its frames, atoms and their strings.
+static size_t footprint(const ligand& l)
+{
+	size_t bytes = sizeof(ligand) + l.frames.capacity() * sizeof(frame) + (l.branch_offsets.capacity() + l.branch_frames.capacity()) * sizeof(uint16_t) + l.atoms.capacity() * sizeof(atom) + l.mutable_atoms.capacity() * sizeof(size_t);
+	for (const auto& a : l.atoms)
+	{
+		for (const string* s : { &a.name, &a.columns_13_to_30, &a.columns_55_to_79 })
+		{
+			if (s->capacity() > 15) bytes += s->capacity() + 1; // Strings of up to 15 characters are stored in place by common implementations.
+		}
+	}
+	return bytes;
+}
+
+fragment_cache::fragment_cache(const vector<path>& fragments, const size_t capacity) : fragments(fragments), num_fragments(fragments.size()), shard_capacity((capacity + num_shards - 1) / num_shards)
+{
+}
+
+fragment_cache::fragment_cache(const vector<shared_ptr<const ligand>>& fragments) : num_fragments(fragments.size()), shard_capacity(0)
+{
+	for (size_t f = 0; f < num_fragments; ++f)
+	{
+		shard& s = shards[f % num_shards];
+		s.lru.push_front(f);
+		s.entries.insert(make_pair(f, make_pair(fragments[f], s.lru.begin())));
+		s.bytes += footprint(*fragments[f]);
+	}
+}
+
+shared_ptr<const ligand> fragment_cache::operator[](const size_t f)
+{
+	shard& s = shards[f % num_shards];
+
+	// Look up the fragment, marking it the most recently used on a hit.
+	{
+		lock_guard<mutex> guard(s.m);
+		const auto e = s.entries.find(f);
+		if (e != s.entries.end())
+		{
+			if (shard_capacity) s.lru.splice(s.lru.begin(), s.lru, e->second.second);
+			return e->second.first;
+		}
+	}
+
+	// Parse the fragment outside the lock, so that lookups of other fragments of the shard proceed meanwhile.
+	const shared_ptr<ligand> l = make_shared<ligand>(fragments[f]);
+	l->id = ligand_id(ligand_id::fragment_generation, f);
+
+	// Insert the fragment unless a concurrent miss has inserted it first, and evict the least recently used fragments beyond the capacity.
+	lock_guard<mutex> guard(s.m);
+	const auto e = s.entries.find(f);
+	if (e != s.entries.end()) return e->second.first;
+	s.lru.push_front(f);
+	s.entries.insert(make_pair(f, make_pair(l, s.lru.begin())));
+	s.bytes += footprint(*l);
+	while (shard_capacity && s.entries.size() > shard_capacity)
+	{
+		const auto victim = s.entries.find(s.lru.back());
+		s.bytes -= footprint(*victim->second.first);
+		s.entries.erase(victim);
+		s.lru.pop_back();
+	}
+	return l;
+}
+
+size_t fragment_cache::resident()
+{
+	size_t n = 0;
+	for (auto& s : shards)
+	{
+		lock_guard<mutex> guard(s.m);
+		n += s.entries.size();
+	}
+	return n;
+}
+
+size_t fragment_cache::resident_bytes()
+{
+	size_t bytes = 0;
+	for (auto& s : shards)
+	{
+		lock_guard<mutex> guard(s.m);
+		bytes += s.bytes;
+	}
+	return bytes;
+}
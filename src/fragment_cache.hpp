@@ -0,0 +1,56 @@
+#pragma once
+#ifndef IGROW_FRAGMENT_CACHE_HPP
+#define IGROW_FRAGMENT_CACHE_HPP
+
+#include <memory>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include "ligand.hpp"
+
+//! Represents a concurrent cache of parsed fragments, sharded by fragment index so that threads looking up different fragments rarely contend.
+//! Fragments are handed out as shared handles to immutable ligands, so that a fragment evicted while in use stays alive until its last user releases it.
+class fragment_cache
+{
+public:
+	static const size_t num_shards = 64; //!< Number of shards, each guarded by its own mutex.
+
+	//! Constructs a cache over a list of fragment files, keeping at most capacity fragments resident with least recently used eviction, or all of them if capacity is 0.
+	explicit fragment_cache(const vector<path>& fragments, const size_t capacity);
+
+	//! Constructs a cache over fragments parsed in memory, all of which stay resident.
+	explicit fragment_cache(const vector<shared_ptr<const ligand>>& fragments);
+
+	//! Returns the f-th fragment, parsing it on a miss. Concurrent misses of the same fragment may parse it more than once, but only one copy is kept.
+	shared_ptr<const ligand> operator[](const size_t f);
+
+	//! Returns the number of fragments.
+	size_t size() const
+	{
+		return num_fragments;
+	}
+
+	//! Returns the number of resident fragments.
+	size_t resident();
+
+	//! Returns the estimated number of bytes occupied by the resident fragments.
+	size_t resident_bytes();
+
+private:
+	//! Represents a shard holding the resident fragments whose indexes are congruent modulo the number of shards.
+	class shard
+	{
+	public:
+		mutex m; //!< Guards the members of the shard.
+		list<size_t> lru; //!< Indexes of the resident fragments from the most to the least recently used.
+		unordered_map<size_t, pair<shared_ptr<const ligand>, list<size_t>::iterator>> entries; //!< Resident fragments and their positions in the lru list.
+		size_t bytes = 0; //!< Estimated number of bytes occupied by the resident fragments.
+	};
+
+	const vector<path> fragments; //!< Paths to the fragment files, or empty if the fragments are supplied in memory.
+	const size_t num_fragments; //!< Number of fragments.
+	const size_t shard_capacity; //!< Maximum number of resident fragments per shard, or 0 for unbounded.
+	array<shard, num_shards> shards; //!< Shards of the cache.
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <random>
+#include "fragment_index.hpp"
+
+//! Tolerance of molecular weight, as the validator sees the sum of the parent weights rounded differently.
+static const double mw_tolerance = 1e-6;
+
+//! Maximum number of weighted draws before falling back to an exhaustive scan of the fitting entries.
+static const size_t max_draws = 32;
+
+addition_share::addition_share(const ligand& l, const size_t g, const bool fragment)
+{
+	const atom& m = l.atoms[l.get_frame(l.mutable_atoms[g]).second];
+	num_rotatable_bonds = l.num_rotatable_bonds + (fragment ? 1 : 0);
+	num_atoms = l.num_atoms - 1;
+	num_heavy_atoms = l.num_heavy_atoms - (m.is_hydrogen() ? 0 : 1);
+	num_hb_donors = l.num_hb_donors - (m.is_hb_donor() ? 1 : 0);
+	num_hb_acceptors = l.num_hb_acceptors;
+	mw = l.mw - m.atomic_weight();
+}
+
+fragment_index::fragment_index(fragment_cache& fragments, const validator& v, const vector<double>& weights) : v(v), num_entries(0)
+{
+	// Bucket the mutable atoms that fit the limits on their own, with every fragment weighing its given weight in total.
+	for (size_t f = 0; f < fragments.size(); ++f)
+	{
+		const shared_ptr<const ligand> lf = fragments[f];
+		const ligand& l = *lf;
+		if (!l.addition_feasible()) continue;
+		const double w = (weights.empty() ? 1.0 : weights[f]) / l.mutable_atoms.size();
+		for (size_t g = 0; g < l.mutable_atoms.size(); ++g)
+		{
+			const addition_share s(l, g, true);
+			if (s.num_rotatable_bonds > v.max_rotatable_bonds || s.num_atoms > v.max_atoms || s.num_heavy_atoms > v.max_heavy_atoms || s.num_hb_donors > v.max_hb_donors || s.num_hb_acceptors > v.max_hb_acceptors || s.mw > v.max_mw + mw_tolerance) continue;
+			if (buckets.size() <= s.num_rotatable_bonds) buckets.resize(s.num_rotatable_bonds + 1);
+			buckets[s.num_rotatable_bonds].push_back(entry(f, g, s, w));
+			++num_entries;
+		}
+	}
+
+	// Sort each bucket by molecular weight and accumulate the sampling weights.
+	for (auto& b : buckets)
+	{
+		stable_sort(b.begin(), b.end(), [](const entry& e0, const entry& e1)
+		{
+			return e0.s.mw < e1.s.mw;
+		});
+		for (size_t k = 1; k < b.size(); ++k)
+		{
+			b[k].w += b[k - 1].w;
+		}
+	}
+}
+
+bool fragment_index::fits(const addition_share& s1, const addition_share& s2) const
+{
+	if (s1.num_rotatable_bonds + s2.num_rotatable_bonds > v.max_rotatable_bonds) return false;
+	if (s1.num_atoms + s2.num_atoms > v.max_atoms) return false;
+	if (s1.num_heavy_atoms + s2.num_heavy_atoms > v.max_heavy_atoms) return false;
+	if (s1.num_hb_donors + s2.num_hb_donors > v.max_hb_donors) return false;
+	if (s1.num_hb_acceptors + s2.num_hb_acceptors > v.max_hb_acceptors) return false;
+	if (s1.mw + s2.mw > v.max_mw + mw_tolerance) return false;
+	return true;
+}
+
+bool fragment_index::sample(const ligand& l1, const size_t g1, philox& eng, size_t& f, size_t& g2) const
+{
+	const addition_share s1(l1, g1, false);
+	if (s1.num_rotatable_bonds >= v.max_rotatable_bonds) return false;
+
+	// Find the prefix of every bucket within the remaining budget of rotatable bonds and molecular weight.
+	const size_t num_buckets = min(buckets.size(), v.max_rotatable_bonds - s1.num_rotatable_bonds + 1);
+	const double max_mw = v.max_mw + mw_tolerance - s1.mw;
+	vector<size_t> ends(num_buckets);
+	vector<double> weights(num_buckets);
+	double total = 0;
+	for (size_t r = 0; r < num_buckets; ++r)
+	{
+		const vector<entry>& b = buckets[r];
+		ends[r] = upper_bound(b.cbegin(), b.cend(), max_mw, [](const double mw, const entry& e)
+		{
+			return mw < e.s.mw;
+		}) - b.cbegin();
+		weights[r] = ends[r] ? b[ends[r] - 1].w : 0;
+		total += weights[r];
+	}
+	if (total == 0) return false;
+
+	// Draw weighted entries from the prefixes until one also fits the remaining budget of the other properties.
+	uniform_real_distribution<double> uniform_weight(0, total);
+	for (size_t d = 0; d < max_draws; ++d)
+	{
+		double x = uniform_weight(eng);
+		size_t r = 0;
+		while (r + 1 < num_buckets && x >= weights[r])
+		{
+			x -= weights[r++];
+		}
+		if (!ends[r]) continue;
+		const vector<entry>& b = buckets[r];
+		const size_t k = min(static_cast<size_t>(upper_bound(b.cbegin(), b.cbegin() + ends[r], x, [](const double x, const entry& e)
+		{
+			return x < e.w;
+		}) - b.cbegin()), ends[r] - 1);
+		if (!fits(s1, b[k].s)) continue;
+		f = b[k].f;
+		g2 = b[k].g;
+		return true;
+	}
+
+	// Scan the prefixes exhaustively for fitting entries, which are rare if all the draws have failed.
+	vector<const entry*> candidates;
+	vector<double> cumulative;
+	double sum = 0;
+	for (size_t r = 0; r < num_buckets; ++r)
+	{
+		const vector<entry>& b = buckets[r];
+		for (size_t k = 0; k < ends[r]; ++k)
+		{
+			if (!fits(s1, b[k].s)) continue;
+			candidates.push_back(&b[k]);
+			sum += b[k].w - (k ? b[k - 1].w : 0);
+			cumulative.push_back(sum);
+		}
+	}
+	if (sum == 0) return false; // Every fitting entry weighs 0, e.g. their fragments have been left unscored.
+	const double x = uniform_real_distribution<double>(0, sum)(eng);
+	const size_t k = min(static_cast<size_t>(upper_bound(cumulative.cbegin(), cumulative.cend(), x) - cumulative.cbegin()), candidates.size() - 1);
+	f = candidates[k]->f;
+	g2 = candidates[k]->g;
+	return true;
+}
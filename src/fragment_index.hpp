@@ -0,0 +1,63 @@
+#pragma once
+#ifndef IGROW_FRAGMENT_INDEX_HPP
+#define IGROW_FRAGMENT_INDEX_HPP
+
+#include "philox.hpp"
+#include "fragment_cache.hpp"
+
+//! Represents the share of the chemical properties of an addition child contributed by one parent when joined at one of its mutable atoms.
+//! The properties of an addition child are exactly the sums of the shares of its two parents, so a child is valid if and only if the sum of the shares fits the limits of the validator.
+class addition_share
+{
+public:
+	size_t num_rotatable_bonds; //!< Share of the number of rotatable bonds.
+	size_t num_atoms; //!< Share of the number of atoms.
+	size_t num_heavy_atoms; //!< Share of the number of heavy atoms.
+	size_t num_hb_donors; //!< Share of the number of hydrogen bond donors.
+	size_t num_hb_acceptors; //!< Share of the number of hydrogen bond acceptors.
+	double mw; //!< Share of the molecular weight.
+
+	//! Constructs the share of a parent ligand joined at its g-th mutable atom. The new rotatable bond is accounted into the share of the fragment.
+	explicit addition_share(const ligand& l, const size_t g, const bool fragment);
+};
+
+//! Represents an index over the mutable atoms of a fragment library, bucketed by their shares of rotatable bonds and sorted by their shares of molecular weight within each bucket.
+//! The index samples a fragment and a mutable atom that fit the remaining budget of a parent ligand, with the same probability as sampling a feasible fragment in proportion to its weight and then uniformly sampling one of its mutable atoms, conditioned on the child being valid.
+class fragment_index
+{
+public:
+	//! Indexes the mutable atoms of the fragments of a cache whose shares alone fit the limits of a validator, weighing every fragment by its entry in weights, or 1 if weights is empty.
+	explicit fragment_index(fragment_cache& fragments, const validator& v, const vector<double>& weights = vector<double>());
+
+	//! Samples a fragment and one of its mutable atoms that form a valid child together with the g1-th mutable atom of ligand l1.
+	//! @return false if no mutable atom of the fragment library fits the remaining budget of l1.
+	bool sample(const ligand& l1, const size_t g1, philox& eng, size_t& f, size_t& g2) const;
+
+	//! Returns the number of indexed mutable atoms.
+	size_t size() const
+	{
+		return num_entries;
+	}
+
+private:
+	//! Represents an indexed mutable atom of a fragment.
+	class entry
+	{
+	public:
+		size_t f; //!< Index to the fragment.
+		size_t g; //!< Index to the mutable atom of the fragment.
+		addition_share s; //!< Share of the child properties.
+		double w; //!< Cumulative sampling weight of the entries of the same bucket up to and including this one.
+
+		explicit entry(const size_t f, const size_t g, const addition_share& s, const double w) : f(f), g(g), s(s), w(w) {}
+	};
+
+	const validator& v; //!< Validator whose limits define the budget.
+	vector<vector<entry>> buckets; //!< Entries bucketed by their shares of rotatable bonds.
+	size_t num_entries; //!< Number of indexed entries.
+
+	//! Returns true if the shares of two parents form a valid child.
+	bool fits(const addition_share& s1, const addition_share& s2) const;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include "hash.hpp"
+#include "fragment_scores.hpp"
+using namespace boost::filesystem;
+
+fragment_scores::fragment_scores(const vector<path>& fragments, fragment_cache& fc, const path& receptor_path, const path& config_path, const path& cache_folder, const path& work_folder, scheduler& sched) : fes(fragments.size()), scored(fragments.size()), num_cached(0), num_docked(0)
+{
+	// Key the cache file by the receptor content and the idock configuration, which determines the box and the docking effort.
+	ostringstream oss;
+	oss << hex << setfill('0') << setw(16) << fnv1a(config_path, fnv1a(receptor_path, fnv1a_basis)) << ".fragments";
+	const path cache_path = cache_folder / oss.str();
+
+	// Read the cached free energies, one fragment filename, hash of the fragment content and free energy per line. Lines of other formats or with malformed fields are skipped, so that their fragments are docked again.
+	map<string, pair<size_t, double>> cache;
+	if (exists(cache_path))
+	{
+		boost::filesystem::ifstream ifs(cache_path);
+		for (string line; getline(ifs, line);)
+		{
+			const size_t comma2 = line.rfind(',');
+			if (comma2 == string::npos || !comma2) continue;
+			const size_t comma1 = line.rfind(',', comma2 - 1);
+			if (comma1 == string::npos) continue;
+			const char* const s = line.c_str();
+			char* end;
+			const size_t hash = strtoull(s + comma1 + 1, &end, 16);
+			if (end == s + comma1 + 1 || end != s + comma2) continue;
+			const double fe = strtod(s + comma2 + 1, &end);
+			if (end == s + comma2 + 1 || *end) continue;
+			cache[line.substr(0, comma1)] = make_pair(hash, fe);
+		}
+	}
+
+	// Copy the fragments feasible for addition that are absent from the cache into the input subfolder of the work folder.
+	const path input_folder = work_folder / "input";
+	const path output_folder = work_folder / "output";
+	vector<string> filenames;
+	vector<shared_ptr<const ligand>> pending;
+	vector<size_t> indexes;
+	vector<size_t> hashes(fragments.size());
+	for (size_t f = 0; f < fragments.size(); ++f)
+	{
+		// Reuse a cached free energy only if the fragment of the same filename still has the same content.
+		const string filename = fragments[f].filename().string();
+		hashes[f] = fnv1a(fragments[f], fnv1a_basis);
+		const auto c = cache.find(filename);
+		if (c != cache.end() && c->second.first == hashes[f])
+		{
+			fes[f] = c->second.second;
+			scored[f] = true;
+			++num_cached;
+			continue;
+		}
+		const shared_ptr<const ligand> l = fc[f];
+		if (!l->addition_feasible()) continue;
+		if (pending.empty())
+		{
+			remove_all(work_folder);
+			create_directories(input_folder);
+			create_directories(output_folder);
+		}
+		copy_file(fragments[f], input_folder / filename);
+		filenames.push_back(filename);
+		pending.push_back(l);
+		indexes.push_back(f);
+	}
+	if (pending.empty()) return;
+
+	// Dock the pending fragments and cache the free energies of those docked, so that quarantined fragments are retried by the next run.
+	vector<const ligand*> ligands(pending.size());
+	for (size_t k = 0; k < pending.size(); ++k)
+	{
+		ligands[k] = pending[k].get();
+	}
+	vector<size_t> quarantined;
+	const int exit_code = sched(input_folder, output_folder, work_folder / "log.csv", filenames, ligands, quarantined);
+	if (exit_code) throw runtime_error("idock exited with code " + to_string(exit_code) + " when docking fragments");
+	for (size_t k = 0; k < pending.size(); ++k)
+	{
+		const path p = output_folder / filenames[k];
+		if (!exists(p)) continue;
+		fes[indexes[k]] = ligand::docked_fe(p);
+		scored[indexes[k]] = true;
+		cache[filenames[k]] = make_pair(hashes[indexes[k]], fes[indexes[k]]);
+		++num_docked;
+	}
+	remove_all(work_folder);
+
+	// Write to a temporary file first so that concurrent runs never read a partially written cache.
+	create_directories(cache_folder);
+	const path tmp_path = cache_folder / unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+	{
+		boost::filesystem::ofstream ofs(tmp_path);
+		ofs.setf(ios::fixed, ios::floatfield);
+		ofs << setprecision(3);
+		for (const auto& c : cache)
+		{
+			ofs << c.first << ',' << hex << setw(16) << setfill('0') << c.second.first << dec << setfill(' ') << ',' << c.second.second << '\n';
+		}
+	}
+	rename(tmp_path, cache_path);
+}
+
+vector<double> fragment_scores::weights(const double temperature) const
+{
+	double min_fe = 0;
+	bool any = false;
+	for (size_t f = 0; f < fes.size(); ++f)
+	{
+		if (!scored[f]) continue;
+		if (!any || fes[f] < min_fe) min_fe = fes[f];
+		any = true;
+	}
+	vector<double> w(fes.size());
+	for (size_t f = 0; f < fes.size(); ++f)
+	{
+		w[f] = scored[f] ? exp((min_fe - fes[f]) / temperature) : 0;
+	}
+	return w;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#ifndef IGROW_FRAGMENT_SCORES_HPP
+#define IGROW_FRAGMENT_SCORES_HPP
+
+#include "scheduler.hpp"
+#include "fragment_cache.hpp"
+
+//! Represents the free energies of the fragments of a library docked against a receptor, cached on disk per receptor and idock configuration so that a library is docked only once per receptor.
+//! Addition samples fragments by their Boltzmann weights at a temperature, so that fragments that bind well are attached more often while the others are still explored.
+class fragment_scores
+{
+public:
+	vector<double> fes; //!< Docked free energy of every fragment, 0 for fragments infeasible for addition or left undocked.
+	vector<bool> scored; //!< True for the fragments whose free energy is cached or docked.
+	size_t num_cached; //!< Number of free energies found in the cache.
+	size_t num_docked; //!< Number of fragments docked to complete the cache.
+
+	//! Reads the free energies of the fragments from the cache folder, keyed by the content of the receptor and of the idock configuration file and matched per fragment by filename and content, docking the fragments feasible for addition that are absent from the cache in a work folder and caching their free energies.
+	explicit fragment_scores(const vector<path>& fragments, fragment_cache& fc, const path& receptor_path, const path& config_path, const path& cache_folder, const path& work_folder, scheduler& sched);
+
+	//! Returns the sampling weight of every fragment, i.e. exp(-(fe - min_fe) / temperature), where min_fe is the lowest free energy of the scored fragments. Fragments left unscored, e.g. quarantined ones, weigh 0 so that addition never samples them.
+	vector<double> weights(const double temperature) const;
+};
+
+#endif
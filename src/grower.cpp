@@ -0,0 +1,371 @@
+#include <chrono>
+#include <mutex>
+#include <limits>
+#include <unordered_set>
+#include "philox.hpp"
+#include "grower.hpp"
+
+grower::grower(const vector<shared_ptr<const ligand>>& fragments, const validator& v, const scorer& score,
+	const size_t num_elitists, const size_t num_additions, const size_t num_subtractions, const size_t num_crossovers,
+	const size_t max_failures, const size_t seed, const size_t num_threads, const options& o) :
+	num_elitists(num_elitists), num_additions(num_additions), num_subtractions(num_subtractions), num_crossovers(num_crossovers),
+	num_children(num_additions + num_subtractions + num_crossovers), max_failures(max_failures), seed(seed), o(o), v(v), score(score),
+	owned_fc(new fragment_cache(fragments)), owned_fi(new fragment_index(*owned_fc, this->v)), owned_io(new io_service_pool(num_threads)),
+	fc(*owned_fc), fi(*owned_fi), io(*owned_io), tabu(o.tabu_searching ? new tabu_memo : nullptr), diversifying(o.max_similarity < 1),
+	elite_fps(diversifying ? num_elitists : 0), child_fps(diversifying ? num_children : 0), priorities(num_children), warm_fes(num_children), duplicates(num_children),
+	num_failures(0), num_created(0), num_tabu_hits(0), creation_seconds(num_children), current_generation(0)
+{
+	ligands.resize(num_elitists + num_children);
+}
+
+grower::grower(fragment_cache& fc, const fragment_index& fi, const validator& v, const scorer& score,
+	const size_t num_elitists, const size_t num_additions, const size_t num_subtractions, const size_t num_crossovers,
+	const size_t max_failures, const size_t seed, io_service_pool& io, const options& o) :
+	num_elitists(num_elitists), num_additions(num_additions), num_subtractions(num_subtractions), num_crossovers(num_crossovers),
+	num_children(num_additions + num_subtractions + num_crossovers), max_failures(max_failures), seed(seed), o(o), v(v), score(score),
+	fc(fc), fi(fi), io(io), tabu(o.tabu_searching ? new tabu_memo : nullptr), diversifying(o.max_similarity < 1),
+	elite_fps(diversifying ? num_elitists : 0), child_fps(diversifying ? num_children : 0), priorities(num_children), warm_fes(num_children), duplicates(num_children),
+	num_failures(0), num_created(0), num_tabu_hits(0), creation_seconds(num_children), current_generation(0)
+{
+	ligands.resize(num_elitists + num_children);
+}
+
+grower::~grower()
+{
+	if (owned_io) owned_io->wait();
+}
+
+void grower::initialize(vector<ligand> initial)
+{
+	if (initial.size() < num_elitists) throw invalid_argument("Failed to initialize the elites from " + to_string(initial.size()) + " ligands, fewer than " + to_string(num_elitists));
+	for (auto& l : initial)
+	{
+		l.docked = true;
+	}
+	stable_sort(initial.begin(), initial.end());
+	for (size_t i = 0; i < num_elitists; ++i)
+	{
+		ligands.replace(i, new ligand(move(initial[i])));
+	}
+}
+
+bool grower::near_elite(const fingerprint& fp) const
+{
+	for (const auto& e : elite_fps)
+	{
+		if (e.tanimoto(fp) > o.max_similarity) return true;
+	}
+	return false;
+}
+
+bool grower::create(const size_t i, const size_t generation)
+{
+	// Children are identified by generation and index, so that their parents can be traced.
+	const ligand_id id(generation, i);
+	const bool adding = i < num_additions;
+	size_t num_valid = 0, num_skips = 0;
+	double best_sfe = 0;
+	for (size_t attempt = 0; num_valid < o.num_candidates && num_failures < max_failures; ++attempt)
+	{
+		// Open the random stream of current attempt.
+		philox eng(seed, generation, i, attempt);
+
+		unique_ptr<ligand> child;
+		const ligand* p1;
+		double parent_fe;
+		operation op(0, 0, 0, 0, 0);
+		if (adding)
+		{
+			// Obtain a constant reference to a random elite feasible for addition.
+			if (addition_parents.empty())
+			{
+				++num_failures;
+				continue;
+			}
+			const ligand& l1 = *addition_parents[uniform_int_distribution<size_t>(0, addition_parents.size() - 1)(eng)];
+
+			// Obtain a random mutable atom from the parent ligand, and sample a fragment and its mutable atom that fit the remaining budget, unless no fragment is known to fit.
+			const size_t g1 = uniform_int_distribution<size_t>(0, l1.mutable_atoms.size() - 1)(eng);
+			const operation unfit(operation::addition, tabu ? operation::id(l1) : 0, fi.size(), g1, 0);
+			if (tabu && tabu->contains(unfit))
+			{
+				++num_tabu_hits;
+				if (++num_skips % tabu_memo::max_skips == 0) ++num_failures;
+				continue;
+			}
+			size_t f, g2;
+			if (!fi.sample(l1, g1, eng, f, g2))
+			{
+				if (tabu) tabu->insert(unfit);
+				++num_failures;
+				continue;
+			}
+			op = operation(operation::addition, tabu ? operation::id(l1) : 0, f, g1, g2);
+			if (!(tabu && tabu->contains(op)))
+			{
+				const shared_ptr<const ligand> l2 = fc[f];
+				child.reset(new ligand(id, l1, *l2, g1, g2));
+			}
+			p1 = &l1;
+			parent_fe = l1.fe;
+		}
+		else if (i < num_additions + num_subtractions)
+		{
+			// Obtain a constant reference to a random elite feasible for subtraction.
+			if (subtraction_parents.empty())
+			{
+				++num_failures;
+				continue;
+			}
+			const ligand& l1 = *subtraction_parents[uniform_int_distribution<size_t>(0, subtraction_parents.size() - 1)(eng)];
+
+			// Obtain a random rotatable bond of the parent ligand, and remove the branch it leads to.
+			const size_t g1 = uniform_int_distribution<size_t>(1, l1.num_rotatable_bonds)(eng);
+			op = operation(operation::subtraction, tabu ? operation::id(l1) : 0, 0, g1, 0);
+			if (!(tabu && tabu->contains(op)))
+			{
+				child.reset(new ligand(id, l1, g1));
+			}
+			p1 = &l1;
+			parent_fe = l1.fe;
+		}
+		else
+		{
+			// Obtain constant references to two random elites feasible for crossover.
+			if (crossover_parents.empty())
+			{
+				++num_failures;
+				continue;
+			}
+			uniform_int_distribution<size_t> uniform_parent(0, crossover_parents.size() - 1);
+			const ligand& l1 = *crossover_parents[uniform_parent(eng)];
+			const ligand& l2 = *crossover_parents[uniform_parent(eng)];
+
+			// Obtain a random rotatable bond from the two parent ligands respectively, and exchange the branches they lead to.
+			const size_t g1 = uniform_int_distribution<size_t>(1, l1.num_rotatable_bonds)(eng);
+			const size_t g2 = uniform_int_distribution<size_t>(1, l2.num_rotatable_bonds)(eng);
+			op = operation(operation::crossover, tabu ? operation::id(l1) : 0, tabu ? operation::id(l2) : 0, g1, g2);
+			if (!(tabu && tabu->contains(op)))
+			{
+				child.reset(new ligand(id, l1, l2, g1, g2, true));
+			}
+			p1 = &l1;
+			parent_fe = (l1.fe + l2.fe) * 0.5;
+		}
+
+		// Skip the operation if it is known to produce an infeasible child, counting a failure every max_skips skips so that sampling terminates even if every operation is tabu.
+		if (!child)
+		{
+			++num_tabu_hits;
+			if (++num_skips % tabu_memo::max_skips == 0) ++num_failures;
+			continue;
+		}
+
+		// Reject the candidate if it is invalid, memorizing its operation as tabu.
+		if (!v(*child))
+		{
+			if (tabu) tabu->insert(op);
+			++num_failures;
+			continue;
+		}
+
+		// Refine the pose of a candidate created by addition warm-started from the docked pose of its parent if requested, and reject the candidate if it clashes with the receptor.
+		const double wfe = adding && o.opt ? (*o.opt)(*child, p1->max_atom_number) : 0;
+		if (o.pf && !(*o.pf)(*child))
+		{
+			if (tabu) tabu->insert(op);
+			++num_failures;
+			continue;
+		}
+
+		// Reject the candidate if it is a near-duplicate of an elite.
+		const fingerprint fp = diversifying ? fingerprint(*child) : fingerprint();
+		if (diversifying && near_elite(fp))
+		{
+			++num_failures;
+			continue;
+		}
+
+		// Keep the candidate if it is the first valid one or it is predicted to bind better than the kept one.
+		const double sfe = adding && o.opt ? wfe : o.sg ? o.sg->score(*child) : 0;
+		if (!num_valid++ || sfe < best_sfe)
+		{
+			best_sfe = sfe;
+			ligands.replace(num_elitists + i, child.release());
+			if (diversifying) child_fps[i] = fp;
+			warm_fes[i] = wfe;
+			priorities[i] = o.sg ? sfe : parent_fe;
+		}
+	}
+	if (!num_valid) return false;
+	++num_created;
+	return true;
+}
+
+bool grower::breed(const observer& on_child)
+{
+	const size_t generation = current_generation + 1;
+
+	// Fingerprint the elites if diversity filtering is requested.
+	for (size_t i = 0; diversifying && i < num_elitists; ++i)
+	{
+		elite_fps[i] = fingerprint(ligands[i]);
+	}
+
+	// Publish immutable snapshots of the elites that are feasible for each operation. The elites stay untouched until all the tasks of current generation complete, so the tasks share them without copying or locking.
+	addition_parents.clear();
+	subtraction_parents.clear();
+	crossover_parents.clear();
+	for (size_t i = 0; i < num_elitists; ++i)
+	{
+		const ligand* const l = &ligands[i];
+		if (l->addition_feasible()) addition_parents.push_back(l);
+		if (l->subtraction_feasible()) subtraction_parents.push_back(l);
+		if (l->crossover_feasible()) crossover_parents.push_back(l);
+	}
+
+	// Forget the infeasible operations on the elites that did not survive.
+	if (tabu)
+	{
+		unordered_set<size_t> elite_ids;
+		for (size_t i = 0; i < num_elitists; ++i)
+		{
+			elite_ids.insert(operation::id(ligands[i]));
+		}
+		tabu->retain(elite_ids);
+	}
+	num_tabu_hits = 0;
+
+	// Create the children in parallel, passing every kept child to the observer.
+	cnt.init(num_children);
+	for (size_t i = 0; i < num_children; ++i)
+	{
+		io.post([&, i, generation]()
+		{
+			const auto start = std::chrono::steady_clock::now();
+			if (create(i, generation) && on_child) on_child(i, ligands[num_elitists + i]);
+			creation_seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			cnt.increment();
+		});
+	}
+	cnt.wait();
+	if (num_failures >= max_failures) return false;
+
+	// Mark the children that are near-duplicates of earlier kept siblings, comparing them chunk by chunk to bound the similarity matrix.
+	fill(duplicates.begin(), duplicates.end(), false);
+	if (diversifying)
+	{
+		const size_t chunk_size = 256;
+		vector<float> similarities;
+		for (size_t chunk = 0; chunk < num_children; chunk += chunk_size)
+		{
+			const size_t chunk_end = min(chunk + chunk_size, num_children);
+			const vector<fingerprint> rows(child_fps.cbegin() + chunk, child_fps.cbegin() + chunk_end);
+			const vector<fingerprint> cols(child_fps.cbegin(), child_fps.cbegin() + chunk_end);
+			similarities.resize(rows.size() * cols.size());
+			similarity_matrix(rows, cols, similarities.data(), io);
+			for (size_t i = chunk; i < chunk_end; ++i)
+			{
+				const float* const row = similarities.data() + (i - chunk) * cols.size();
+				size_t j = 0;
+				while (j < i && (duplicates[j] || !(row[j] > o.max_similarity))) ++j;
+				duplicates[i] = j < i;
+			}
+		}
+	}
+	return true;
+}
+
+const vector<bool>& grower::rank()
+{
+	// Select the elites by partially sorting a compact array of free energies and population indexes, ranking undocked ligands last. Ties are broken by index.
+	const size_t num_ligands = ligands.size();
+	keys.clear();
+	keys.reserve(num_ligands);
+	for (size_t i = 0; i < num_ligands; ++i)
+	{
+		keys.push_back(make_pair(ligands[i].docked ? ligands[i].fe : numeric_limits<double>::infinity(), i));
+	}
+	nth_element(keys.begin(), keys.begin() + num_elitists, keys.end());
+	sort(keys.begin(), keys.begin() + num_elitists);
+	sort(keys.begin() + num_elitists, keys.end(), [](const pair<double, size_t>& k0, const pair<double, size_t>& k1)
+	{
+		return k0.second < k1.second;
+	});
+	elite.assign(num_ligands, false);
+	for (size_t j = 0; j < num_elitists; ++j)
+	{
+		elite[keys[j].second] = true;
+	}
+	return elite;
+}
+
+void grower::select()
+{
+	if (!o.large_population)
+	{
+		// Sort ligands in ascending order of efficacy.
+		ligands.sort();
+	}
+	else
+	{
+		// Shed the previous elites that are no longer elite.
+		for (size_t i = 0; i < num_elitists; ++i)
+		{
+			if (!elite[i]) ligands[i].shed();
+		}
+
+		// Reorder the population so that the elites come first in ascending order of free energy and the others follow in index order.
+		auto& base = ligands.base();
+		vector<void*> reordered;
+		reordered.reserve(base.size());
+		for (const auto& k : keys)
+		{
+			reordered.push_back(base[k.second]);
+		}
+		base.swap(reordered);
+	}
+	++current_generation;
+}
+
+bool grower::step()
+{
+	if (!breed()) return false;
+
+	// Score the children in parallel except the near-duplicates, which are left unscored, keeping the first exception thrown by the scorer if any.
+	mutex m;
+	exception_ptr error;
+	cnt.init(num_children);
+	for (size_t i = 0; i < num_children; ++i)
+	{
+		io.post([&, i]()
+		{
+			ligand& l = ligands[num_elitists + i];
+			try
+			{
+				l.fe = duplicates[i] ? 0 : score(l);
+				l.docked = !duplicates[i];
+			}
+			catch (...)
+			{
+				lock_guard<mutex> guard(m);
+				if (!error) error = current_exception();
+			}
+			cnt.increment();
+		});
+	}
+	cnt.wait();
+	if (error) rethrow_exception(error);
+
+	// Shed the structures of the children that are not elite in large-population mode.
+	if (o.large_population)
+	{
+		const vector<bool>& elites = rank();
+		for (size_t i = 0; i < num_children; ++i)
+		{
+			if (!elites[num_elitists + i]) ligands[num_elitists + i].shed();
+		}
+	}
+	select();
+	return true;
+}
@@ -0,0 +1,205 @@
+#pragma once
+#ifndef IGROW_GROWER_HPP
+#define IGROW_GROWER_HPP
+
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include "io_service_pool.hpp"
+#include "safe_counter.hpp"
+#include "fragment_index.hpp"
+#include "surrogate.hpp"
+#include "optimizer.hpp"
+#include "prefilter.hpp"
+#include "tabu_memo.hpp"
+#include "fingerprint.hpp"
+using boost::ptr_vector;
+
+//! Represents the generation loop of igrow, which creates children by addition, subtraction and crossover in parallel from the elites and selects the best ligands by free energy as the elites of the next generation.
+//! Every random choice is drawn from Philox streams keyed by the seed, the generation, the child and the attempt.
+//! Embedding programs run whole generations by step(), scoring the children by a callback. The igrow executable runs the stages of a generation itself, i.e. breed(), its docking of the children, and then rank() and select(), so that both share the same loop.
+class grower
+{
+public:
+	//! Scores a child in place and returns its predicted free energy. A scorer may move the atoms of the child to its docked pose, which the child then passes on to its own children.
+	//! Children are scored concurrently, so a scorer must be thread safe.
+	typedef function<double(ligand&)> scorer;
+
+	//! Observes a kept child, given its index among the children, as soon as it is created. Children are created concurrently, so an observer must be thread safe.
+	typedef function<void(const size_t, ligand&)> observer;
+
+	//! Represents the optional stages of creating a child, all of which are disabled by default.
+	class options
+	{
+	public:
+		size_t num_candidates; //!< Number of valid candidates created per child, of which the one predicted to bind best by the surrogate is kept.
+		const surrogate* sg; //!< Surrogate scoring the candidates and prioritizing the children, or nullptr.
+		const optimizer* opt; //!< Optimizer refining the candidates created by addition against the surrogate, or nullptr.
+		const prefilter* pf; //!< Geometric prefilter rejecting the candidates that leave the box or clash with the receptor, or nullptr.
+		bool tabu_searching; //!< True if the operations on surviving elites that produced invalid or clashing candidates are memorized and skipped.
+		double max_similarity; //!< Maximum Tanimoto similarity of children to elites and earlier siblings, 1 to disable diversity filtering.
+		bool large_population; //!< True if the elites are selected by partial sorting and the structures of the non-elites are shed.
+
+		explicit options() : num_candidates(1), sg(nullptr), opt(nullptr), pf(nullptr), tabu_searching(false), max_similarity(1), large_population(false) {}
+	};
+
+	const size_t num_elitists; //!< Number of elite ligands carried over.
+	const size_t num_additions; //!< Number of children created by addition.
+	const size_t num_subtractions; //!< Number of children created by subtraction.
+	const size_t num_crossovers; //!< Number of children created by crossover.
+	const size_t num_children; //!< Number of children per generation.
+	const size_t max_failures; //!< Maximum number of operational failures tolerated across generations.
+	const size_t seed; //!< Random seed.
+	const options o; //!< Optional stages of creating a child.
+
+	//! Constructs a grower over fragments parsed in memory, creating children valid for a validator and scoring them by a scorer on num_threads threads.
+	//! Children record the identities of their parents, so the fragments and the initial ligands should carry distinct identities, e.g. ligand_id(ligand_id::fragment_generation, f) for the f-th fragment and ligand_id(0, i) for the i-th initial ligand.
+	explicit grower(const vector<shared_ptr<const ligand>>& fragments, const validator& v, const scorer& score,
+		const size_t num_elitists, const size_t num_additions, const size_t num_subtractions, const size_t num_crossovers,
+		const size_t max_failures, const size_t seed, const size_t num_threads, const options& o = options());
+
+	//! Constructs a grower sampling fragments from a fragment cache by a fragment index built for a validator, and running on the threads of an io service pool, all of which must outlive the grower.
+	//! The scorer may be empty if the caller scores the children itself between breed() and rank(), in which case step() must not be called.
+	explicit grower(fragment_cache& fc, const fragment_index& fi, const validator& v, const scorer& score,
+		const size_t num_elitists, const size_t num_additions, const size_t num_subtractions, const size_t num_crossovers,
+		const size_t max_failures, const size_t seed, io_service_pool& io, const options& o = options());
+
+	//! Waits for the worker threads to exit if the grower owns them.
+	~grower();
+
+	//! Selects the best num_elitists of the given scored ligands as the initial elites.
+	//! @exception invalid_argument Thrown when there are fewer than num_elitists ligands.
+	void initialize(vector<ligand> initial);
+
+	//! Runs a generation, i.e. creates the children from the current elites, scores them and selects the elites of the next generation from the elites and the children.
+	//! Exceptions thrown by the scorer are propagated once all the children are scored.
+	//! @return false, leaving the elites intact, if the number of failures reaches max_failures before all the children are created.
+	bool step();
+
+	//! Creates the children of the next generation from the current elites in parallel, passing every kept child to an observer if any, and marks the children that are near-duplicates of earlier kept siblings if diversity filtering is enabled.
+	//! @return false if the number of failures reaches max_failures before all the children are created.
+	bool breed(const observer& on_child = observer());
+
+	//! Flags the ligands of the population that are elites of the next generation, given the free energies of the children. Required before select() in large-population mode only.
+	const vector<bool>& rank();
+
+	//! Selects the elites of the next generation and completes the generation. In large-population mode, the structures of the previous elites that are no longer elite are shed and the others follow the elites in index order.
+	void select();
+
+	//! Returns the i-th ligand of the population in ascending order of free energy, of which the first num_elitists are the elites. The children of the last generation follow the elites only until the next generation starts.
+	const ligand& operator[](const size_t i) const
+	{
+		return ligands[i];
+	}
+
+	//! Returns the i-th ligand of the population for scoring the children between breed() and rank().
+	ligand& operator[](const size_t i)
+	{
+		return ligands[i];
+	}
+
+	//! Returns the number of ligands of the population, i.e. the elites followed by the children.
+	size_t size() const
+	{
+		return ligands.size();
+	}
+
+	//! Returns the number of generations run.
+	size_t generation() const
+	{
+		return current_generation;
+	}
+
+	//! Returns the number of operational failures accumulated.
+	size_t failures() const
+	{
+		return num_failures;
+	}
+
+	//! Returns the number of children created.
+	size_t created() const
+	{
+		return num_created;
+	}
+
+	//! Returns the wall time in seconds of creating every child of the last generation, including its failed attempts.
+	const vector<double>& creation_times() const
+	{
+		return creation_seconds;
+	}
+
+	//! Returns the docking priority of the i-th child, i.e. its free energy predicted by the surrogate if available, or otherwise the average free energy of its elite parents.
+	double priority(const size_t i) const
+	{
+		return priorities[i];
+	}
+
+	//! Returns the free energy of the i-th child refined by the optimizer, if it is created by addition and warm starting is enabled.
+	double warm_fe(const size_t i) const
+	{
+		return warm_fes[i];
+	}
+
+	//! Returns true if the i-th child of the last generation is a near-duplicate of an earlier kept sibling, which is to be left unscored.
+	bool duplicate(const size_t i) const
+	{
+		return duplicates[i];
+	}
+
+	//! Returns the number of children of the last generation that are near-duplicates of earlier kept siblings.
+	size_t num_duplicates() const
+	{
+		return count(duplicates.cbegin(), duplicates.cend(), true);
+	}
+
+	//! Returns the number of operations skipped as tabu in the last generation.
+	size_t tabu_hits() const
+	{
+		return num_tabu_hits;
+	}
+
+	//! Returns the number of operations memorized as tabu.
+	size_t tabu_size() const
+	{
+		return tabu ? tabu->size() : 0;
+	}
+
+private:
+	const validator v; //!< Ligand validator.
+	const scorer score; //!< Scoring callback.
+	const unique_ptr<fragment_cache> owned_fc; //!< Fragments parsed in memory, if owned by the grower.
+	const unique_ptr<const fragment_index> owned_fi; //!< Index of the fragments parsed in memory, if owned by the grower.
+	const unique_ptr<io_service_pool> owned_io; //!< Worker threads, if owned by the grower.
+	fragment_cache& fc; //!< Resident fragments.
+	const fragment_index& fi; //!< Index of the mutable atoms of the fragments.
+	io_service_pool& io; //!< Worker threads.
+	const unique_ptr<tabu_memo> tabu; //!< Memo of infeasible operations, if tabu searching is enabled.
+	const bool diversifying; //!< True if diversity filtering is enabled.
+	safe_counter<size_t> cnt; //!< Counter of completed tasks.
+	ptr_vector<ligand> ligands; //!< Elites followed by children.
+	vector<const ligand*> addition_parents; //!< Elites feasible for addition in current generation.
+	vector<const ligand*> subtraction_parents; //!< Elites feasible for subtraction in current generation.
+	vector<const ligand*> crossover_parents; //!< Elites feasible for crossover in current generation.
+	vector<fingerprint> elite_fps; //!< Fingerprints of the elites in current generation.
+	vector<fingerprint> child_fps; //!< Fingerprints of the children in current generation.
+	vector<double> priorities; //!< Docking priorities of the children.
+	vector<double> warm_fes; //!< Refined free energies of the children created by addition.
+	vector<bool> duplicates; //!< Near-duplicate flags of the children.
+	vector<pair<double, size_t>> keys; //!< Free energies and population indexes, the elites first, in large-population mode.
+	vector<bool> elite; //!< Elite flags of the population in large-population mode.
+	atomic<size_t> num_failures; //!< Number of operational failures.
+	atomic<size_t> num_created; //!< Number of children created.
+	atomic<size_t> num_tabu_hits; //!< Number of operations skipped as tabu in current generation.
+	vector<double> creation_seconds; //!< Wall time of creating every child of the last generation.
+	size_t current_generation; //!< Number of generations run.
+
+	//! Creates the i-th child of a generation, retrying with fresh random streams until num_candidates candidates are valid or the failures run out, and keeps the best candidate.
+	//! @return false if the failures have run out.
+	bool create(const size_t i, const size_t generation);
+
+	//! Returns true if a fingerprint is more similar than allowed to the fingerprint of an elite.
+	bool near_elite(const fingerprint& fp) const;
+};
+
+#endif
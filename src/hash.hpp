@@ -0,0 +1,32 @@
+#pragma once
+#ifndef IGROW_HASH_HPP
+#define IGROW_HASH_HPP
+
+#include <string>
+#include <iterator>
+#include <boost/filesystem/fstream.hpp>
+using namespace std;
+using boost::filesystem::path;
+
+const size_t fnv1a_basis = 14695981039346656037ULL; //!< Offset basis of the 64-bit FNV-1a hash.
+
+//! Folds a byte sequence into a 64-bit FNV-1a hash.
+inline size_t fnv1a(const char* data, const size_t size, size_t h)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+//! Folds the content of a file into a 64-bit FNV-1a hash.
+inline size_t fnv1a(const path& p, const size_t h)
+{
+	boost::filesystem::ifstream ifs(p, ios::binary);
+	const string content((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+	return fnv1a(content.data(), content.size(), h);
+}
+
+#endif
@@ -3,16 +3,40 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/algorithm/string.hpp>
 #include "array.hpp"
+#include "transform.hpp"
 #include "ligand.hpp"
 using namespace boost;
 using namespace boost::filesystem;
 
-ligand::ligand(const path& p) : p(p), num_heavy_atoms(0), num_hb_donors(0), num_hb_acceptors(0), mw(0)
+const uint32_t ligand_id::fragment_generation;
+const uint32_t ligand_id::none;
+
+ligand::ligand(const path& p) : num_heavy_atoms(0), num_hb_donors(0), num_hb_acceptors(0), mw(0), docked(false)
+{
+	boost::filesystem::ifstream ifs(p);
+	parse(ifs, p);
+}
+
+ligand::ligand(istream& is, const path& p) : num_heavy_atoms(0), num_hb_donors(0), num_hb_acceptors(0), mw(0), docked(false)
+{
+	parse(is, p);
+}
+
+ostream& operator<<(ostream& os, const connector& c)
+{
+	if (!c.c_srn) return os;
+	const auto name = [](const array<char, 4>& n)
+	{
+		return string(n.begin(), find(n.begin(), n.end(), '\0'));
+	};
+	return os << c.c_srn << ':' << name(c.c_name) << " - " << c.m_srn << ':' << name(c.m_name);
+}
+
+void ligand::parse(istream& is, const path& p)
 {
 	// Initialize necessary variables for constructing a ligand.
 	frames.reserve(30); // A ligand typically consists of <= 30 frames.
 	frames.push_back(frame(0, 0, 0, 0)); // ROOT is also treated as a frame. The parent, rotorX, and rotorY of ROOT frame are dummy.
-	frames.back().branches.reserve(4); // A frame typically consists of <= 4 BRANCH frames.
 	mutable_atoms.reserve(20); // A ligand typically consists of <= 20 mutable atoms.
 
 	// Initialize helper variables for parsing.
@@ -23,8 +47,7 @@ ligand::ligand(const path& p) : p(p), num_heavy_atoms(0), num_hb_donors(0), num_
 	line.reserve(79); // According to PDBQT specification, the last item AutoDock4 atom type locates at 1-based [78, 79].
 
 	// Parse ATOM/HETATM, BRANCH, ENDBRANCH.
-	boost::filesystem::ifstream ifs(p); // Parsing starts. Open the file stream as late as possible.
-	while (getline(ifs, line))
+	while (getline(is, line))
 	{
 		++num_lines;
 		const string record = line.substr(0, 6);
@@ -35,6 +58,9 @@ ligand::ligand(const path& p) : p(p), num_heavy_atoms(0), num_hb_donors(0), num_
 			assert(current == frames.size() - 1);
 			assert(f == &frames.back());
 
+			// Reject a ligand whose atom indexes would overflow the frames.
+			if (atoms.size() == frame::capacity) throw domain_error("Error parsing " + p.filename().string() + ": the ligand has more than " + to_string(frame::capacity) + " atoms.");
+
 			// Validate the AutoDock4 atom type.
 			const string ad_type_string = line.substr(77, isspace(line[78]) ? 1 : 2);
 			const size_t ad = atom::parse_ad_string(ad_type_string);
@@ -54,23 +80,20 @@ ligand::ligand(const path& p) : p(p), num_heavy_atoms(0), num_hb_donors(0), num_
 		}
 		else if (record == "BRANCH")
 		{
+			// Reject a ligand whose frame indexes would overflow the frames and branches.
+			if (frames.size() == frame::capacity) throw domain_error("Error parsing " + p.filename().string() + ": the ligand has more than " + to_string(frame::capacity) + " frames.");
+
 			// Parse "BRANCH   X   Y". X and Y are right-justified and 4 characters wide.
 			frames.push_back(frame(current, stoul(line.substr(6, 4)), stoul(line.substr(10, 4)), atoms.size()));
 
 			// Now the current frame is the newly inserted BRANCH frame.
 			current = frames.size() - 1;
 
-			// The parent frame has the current frame as one of its branches.
-			f->branches.push_back(current);
-
 			// Update the pointer to the current frame.
 			f = &frames[current];
 
 			// The ending index of atoms of previous frame is the starting index of atoms of current frame.
 			frames[current - 1].end = f->begin;
-
-			// Reserve enough capacity for storing BRANCH frames.
-			f->branches.reserve(4); // A frame typically consists of <= 4 BRANCH frames.
 		}
 		else if (record == "ENDBRA")
 		{
@@ -85,7 +108,6 @@ ligand::ligand(const path& p) : p(p), num_heavy_atoms(0), num_hb_donors(0), num_
 			f = &frames[current];
 		}
 	}
-	ifs.close(); // Parsing finishes. Close the file stream as soon as possible.
 
 	assert(current == 0); // current should remain its original value if "BRANCH" and "ENDBRANCH" properly match each other.
 	assert(f == &frames.front()); // The frame pointer should point to the ROOT frame.
@@ -100,40 +122,75 @@ ligand::ligand(const path& p) : p(p), num_heavy_atoms(0), num_hb_donors(0), num_
 	num_rotatable_bonds = frames.size() - 1;
 	assert(num_atoms + (num_rotatable_bonds << 1) + 3 <= num_lines); // ATOM/HETATM lines + BRANCH/ENDBRANCH lines + ROOT/ENDROOT/TORSDOF lines + REMARK lines (if any) == num_lines
 
-	// Determine the maximum atom serial number.
-	max_atom_number = atoms.back().srn;
+	// Determine the maximum atom serial number. Atoms of ligands saved by igrow are not necessarily ordered by serial number.
+	max_atom_number = 0;
+	for (const auto& a : atoms)
+	{
+		if (max_atom_number < a.srn) max_atom_number = a.srn;
+	}
 	assert(max_atom_number >= num_atoms);
+
+	// Index the branches of every frame.
+	index_branches();
 }
 
-void ligand::save() const
+void ligand::index_branches()
+{
+	// Count the branches of every frame, and turn the counts into offsets.
+	const size_t num_frames = frames.size();
+	branch_offsets.assign(num_frames + 1, 0);
+	for (size_t k = 1; k < num_frames; ++k)
+	{
+		++branch_offsets[frames[k].parent + 1];
+	}
+	for (size_t k = 0; k < num_frames; ++k)
+	{
+		branch_offsets[k + 1] += branch_offsets[k];
+	}
+
+	// Place every BRANCH frame after the preceding branches of its parent. As frames are visited in ascending order, so are the branches of each frame.
+	branch_frames.resize(num_frames - 1);
+	vector<uint16_t> next(branch_offsets.begin(), branch_offsets.end() - 1);
+	for (size_t k = 1; k < num_frames; ++k)
+	{
+		branch_frames[next[frames[k].parent]++] = static_cast<uint16_t>(k);
+	}
+}
+
+void ligand::save(const path& p) const
 {
 	boost::filesystem::ofstream ofs(p); // Dumping starts. Open the file stream as late as possible.
+	save(ofs);
+	ofs.close();
+}
+
+void ligand::save(ostream& os) const
+{
 	using namespace std;
-	ofs.setf(ios::fixed, ios::floatfield);
-	ofs << setprecision(3);
+	const ios::fmtflags flags = os.flags();
+	const streamsize precision = os.precision();
+	os.setf(ios::fixed, ios::floatfield);
+	os << setprecision(3);
 
 	// Dump the ROOT frame.
-	ofs << "ROOT\n";
+	os << "ROOT\n";
 	{
 		const frame& f = frames.front();
 		for (size_t i = f.begin; i < f.end; ++i)
 		{
 			const atom& a = atoms[i];
-			ofs << "ATOM  " << setw(5) << a.srn << ' ' << a.columns_13_to_30 << setw(8) << a.coordinate[0] << setw(8) << a.coordinate[1] << setw(8) << a.coordinate[2] << a.columns_55_to_79 << '\n';
+			os << "ATOM  " << setw(5) << a.srn << ' ' << a.columns_13_to_30 << setw(8) << a.coordinate[0] << setw(8) << a.coordinate[1] << setw(8) << a.coordinate[2] << a.columns_55_to_79 << '\n';
 		}
 	}
-	ofs << "ENDROOT\n";
+	os << "ENDROOT\n";
 
 	// Dump the BRANCH frames.
 	vector<bool> dump_branches(frames.size()); // dump_branches[0] is dummy. The ROOT frame has been dumped.
 	vector<size_t> stack; // Stack to track the depth-first traversal sequence of frames in order to avoid recursion.
 	stack.reserve(num_rotatable_bonds); // The ROOT frame is excluded.
+	for (size_t j = num_branches(0); j;)
 	{
-		const frame& f = frames.front();
-		for (auto i = f.branches.rbegin(); i < f.branches.rend(); ++i)
-		{
-			stack.push_back(*i);
-		}
+		stack.push_back(branch(0, --j));
 	}
 	while (!stack.empty())
 	{
@@ -141,31 +198,33 @@ void ligand::save() const
 		const frame& f = frames[fn];
 		if (!dump_branches[fn]) // This BRANCH frame has not been dumped.
 		{
-			ofs << "BRANCH"    << setw(4) << f.rotorX << setw(4) << f.rotorY << '\n';
+			os << "BRANCH"    << setw(4) << f.rotorX << setw(4) << f.rotorY << '\n';
 			for (size_t i = f.begin; i < f.end; ++i)
 			{
 				const atom& a = atoms[i];
-				ofs << "ATOM  " << setw(5) << a.srn << ' ' << a.columns_13_to_30 << setw(8) << a.coordinate[0] << setw(8) << a.coordinate[1] << setw(8) << a.coordinate[2] << a.columns_55_to_79 << '\n';
+				os << "ATOM  " << setw(5) << a.srn << ' ' << a.columns_13_to_30 << setw(8) << a.coordinate[0] << setw(8) << a.coordinate[1] << setw(8) << a.coordinate[2] << a.columns_55_to_79 << '\n';
 			}
 			dump_branches[fn] = true;
-			for (auto i = f.branches.rbegin(); i < f.branches.rend(); ++i)
+			for (size_t j = num_branches(fn); j;)
 			{
-				stack.push_back(*i);
+				stack.push_back(branch(fn, --j));
 			}
 		}
 		else // This BRANCH frame has been dumped.
 		{
-			ofs << "ENDBRANCH" << setw(4) << f.rotorX << setw(4) << f.rotorY << '\n';
+			os << "ENDBRANCH" << setw(4) << f.rotorX << setw(4) << f.rotorY << '\n';
 			stack.pop_back();
 		}
 	}
-	ofs << "TORSDOF " << num_rotatable_bonds << '\n';
-	ofs.close();
+	os << "TORSDOF " << num_rotatable_bonds << '\n';
+	os.flags(flags);
+	os.precision(precision);
 }
 
 void ligand::update(const path& p)
 {
-	if (!exists(p))
+	docked = exists(p);
+	if (!docked)
 	{
 		fe = 0;
 		return;
@@ -191,7 +250,36 @@ void ligand::update(const path& p)
 		}
 	}
 	ifs.close();
-	save();
+}
+
+double ligand::docked_fe(const path& p)
+{
+	if (!exists(p)) return 0;
+	string line;
+	line.reserve(79);
+	boost::filesystem::ifstream ifs(p);
+	getline(ifs, line); // MODEL        1
+	getline(ifs, line); // REMARK       NORMALIZED FREE ENERGY PREDICTED BY IDOCK:  -4.976 KCAL/MOL
+	return stod(line.substr(55, 8));
+}
+
+void ligand::shed()
+{
+	vector<frame>().swap(frames);
+	vector<uint16_t>().swap(branch_offsets);
+	vector<uint16_t>().swap(branch_frames);
+	vector<atom>().swap(atoms);
+	vector<size_t>().swap(mutable_atoms);
+}
+
+void ligand::rehydrate(const path& p)
+{
+	ligand l(p);
+	frames.swap(l.frames);
+	branch_offsets.swap(l.branch_offsets);
+	branch_frames.swap(l.branch_frames);
+	atoms.swap(l.atoms);
+	mutable_atoms.swap(l.mutable_atoms);
 }
 
 pair<size_t, size_t> ligand::get_frame(const size_t srn) const
@@ -219,7 +307,7 @@ pair<size_t, size_t> ligand::get_frame(const size_t srn) const
 	throw domain_error("Failed to find an atom with serial number " + to_string(srn));
 }
 
-ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g1, const size_t g2) : p(p), parent1(l1.p), parent2(l2.p)
+ligand::ligand(const ligand_id id, const ligand& l1, const ligand& l2, const size_t g1, const size_t g2) : id(id), parent1(l1.id), parent2(l2.id), docked(false)
 {
 	assert(g1 < l1.mutable_atoms.size());
 	assert(g2 < l2.mutable_atoms.size());
@@ -263,8 +351,8 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 	assert(f2idx == l2.get_frame(c2.srn).first);
 
 	// Set the connector bonds.
-	connector1 = to_string(c1.srn) + ":" + c1.name + " - " + to_string(m1.srn) + ":" + m1.name;
-	connector2 = to_string(c2.srn) + ":" + c2.name + " - " + to_string(m2.srn) + ":" + m2.name;
+	connector1 = connector(c1, m1);
+	connector2 = connector(c2, m2);
 
 	// The maximum atom serial number of child ligand is equal to the sum of its parent ligands.
 	max_atom_number = l1.max_atom_number + l2.max_atom_number;
@@ -304,20 +392,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			f.branches.push_back(b > f1idx ? l2_num_frames + b : b);
-		}
-
 		// Populate atoms.
 		assert(f.begin == rf.begin);
 		for (size_t i = rf.begin; i < rf.end; ++i)
@@ -331,20 +410,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 	// Create a new frame for ligand 1's f1 frame itself.
 	{
 		// The reference frame is f1.
-		const size_t f1_num_branches = f1.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(f1.parent, f1.rotorX, f1.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(1 + f1_num_branches); // This frame exactly consists of 1 + f1_num_branches BRANCH frames.
-		f.branches.push_back(f1_num_frames);
-		for (size_t i = 0; i < f1_num_branches; ++i)
-		{
-			f.branches.push_back(l2_num_frames + f1.branches[i]);
-		}
-
 		// Populate atoms.
 		assert(f.begin == f1.begin);
 		for (size_t i = f1.begin; i < m1idx; ++i)
@@ -374,9 +444,10 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 			l2_to_l4_mapping[k] = l4_to_l2_mapping.size();
 			l4_to_l2_mapping.push_back(k);
 			const frame& rf = l2.frames[k];
-			for (auto i = rf.branches.rbegin(); i < rf.branches.rend(); ++i)
+			for (size_t j = l2.num_branches(k); j;)
 			{
-				if (find(l4_to_l2_mapping.begin(), l4_to_l2_mapping.end(), *i) == l4_to_l2_mapping.end()) stack.push_back(*i);
+				const size_t b = l2.branch(k, --j);
+				if (find(l4_to_l2_mapping.begin(), l4_to_l2_mapping.end(), b) == l4_to_l2_mapping.end()) stack.push_back(b);
 			}
 			if (find(l4_to_l2_mapping.begin(), l4_to_l2_mapping.end(), rf.parent) == l4_to_l2_mapping.end()) stack.push_back(rf.parent);
 		}
@@ -392,7 +463,15 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 	const array<double, 3> c2_to_m2_nd = normalize(m2.coordinate - c2.coordinate); // Normalized vector pointing from c2 to m2.
 	const array<double, 9> rot = vec3_to_mat3(normalize(cross_product(c2_to_m2_nd, c2_to_c1_nd)), c2_to_m2_nd * c2_to_c1_nd); // Rotation matrix to rotate m2 along the normal to the direction from the new position of c2 to c1.
 
-	// Create a new frame for ligand 2's f2 frame itself. Its branches are separately considered, depending on whether f2 is the ROOT frame of ligand 2.
+	// Transform the coordinates of all the atoms of ligand 2 in a batch, i.e. rot * (coordinate - c2.coordinate) + origin_to_c2.
+	soa_coordinates l2_coordinates(l2.num_atoms);
+	for (size_t i = 0; i < l2.num_atoms; ++i)
+	{
+		l2_coordinates.set(i, l2.atoms[i].coordinate);
+	}
+	transform(l2_coordinates, l2_coordinates, rot, c2.coordinate, origin_to_c2);
+
+	// Create a new frame for ligand 2's f2 frame itself.
 	{
 		// The reference frame is f2.
 		assert(&f2 == &l2.frames[l4_to_l2_mapping[0]]);
@@ -405,53 +484,25 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 		for (size_t i = f2.begin; i < m2idx; ++i)
 		{
 			const atom& ra = l2.atoms[i];
-			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, rot * (ra.coordinate - c2.coordinate) + origin_to_c2, ra.ad));
+			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, l2_coordinates.get(i), ra.ad));
 		}
 		for (size_t i = m2idx + 1; i < f2.end; ++i)
 		{
 			const atom& ra = l2.atoms[i];
-			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, rot * (ra.coordinate - c2.coordinate) + origin_to_c2, ra.ad));
+			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, l2_coordinates.get(i), ra.ad));
 		}
 		f.end = atoms.size();
 		assert(f.begin < f.end);
 	}
 
-	if (!f2idx) // f2 is the ROOT frame of ligand 2.
-	{
-		assert(l2_to_l4_mapping[0] == 0);
-		const size_t f2_num_branches = f2.branches.size();
-		frame& f = frames.back();
-
-		// Populate branches.
-		f.branches.reserve(f2_num_branches); // This frame exactly consists of f2_num_branches BRANCH frames.
-		for (size_t i = 0; i < f2_num_branches; ++i)
-		{
-			f.branches.push_back(f1_num_frames + l2_to_l4_mapping[f2.branches[i]]);
-		}
-	}
-	else // f2 is not the ROOT frame of ligand 2.
+	if (f2idx) // f2 is not the ROOT frame of ligand 2.
 	{
-		{
-			const size_t f2_num_branches = f2.branches.size();
-			frame& f = frames.back();
-
-			// Populate branches.
-			f.branches.reserve(1 + f2_num_branches); // This frame exactly consists of 1 + f2_num_branches BRANCH frames.
-			f.branches.push_back(f1_num_frames + l2_to_l4_mapping[f2.parent]);
-			for (size_t i = 0; i < f2_num_branches; ++i)
-			{
-				f.branches.push_back(f1_num_frames + l2_to_l4_mapping[f2.branches[i]]);
-			}
-		}
-
 		// Create new frames for ligand 2's frames that are parent frames of f2 except ROOT.
 		assert(l2_to_l4_mapping[0] >= 1);
 		for (size_t k = 1; k < l2_to_l4_mapping.front(); ++k)
 		{
 			// Obtain a constant reference to the corresponding frame of ligand 2.
 			const frame& rf = l2.frames[l4_to_l2_mapping[k]];
-			const size_t rf_num_branches = rf.branches.size();
-			assert(rf_num_branches >= 1);
 
 			// Create a new frame based on the reference frame.
 			const frame& pf = l2.frames[l4_to_l2_mapping[k - 1]];
@@ -459,21 +510,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 			frames.push_back(frame(f1idx + k, l1.max_atom_number + pf.rotorY, l1.max_atom_number + pf.rotorX, atoms.size()));
 			frame& f = frames.back();
 
-			// Populate branches.
-			f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-			f.branches.push_back(f1_num_frames + l2_to_l4_mapping[rf.parent]);
-			const size_t b = l4_to_l2_mapping[k - 1];
-			for (size_t i = 0; i < rf_num_branches; ++i)
-			{
-				if (rf.branches[i] == b) continue;
-				f.branches.push_back(f1_num_frames + l2_to_l4_mapping[rf.branches[i]]);
-			}
-
 			// Populate atoms.
 			for (size_t i = rf.begin; i < rf.end; ++i)
 			{
 				const atom& ra = l2.atoms[i];
-				atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, rot * (ra.coordinate - c2.coordinate) + origin_to_c2, ra.ad));
+				atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, l2_coordinates.get(i), ra.ad));
 			}
 			f.end = atoms.size();
 			assert(f.begin < f.end);
@@ -483,8 +524,6 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 		{
 			// Obtain a constant reference to the corresponding frame of ligand 2.
 			const frame& rf = l2.frames.front();
-			const size_t rf_num_branches = rf.branches.size();
-			assert(rf_num_branches >= 1);
 
 			// Create a new frame based on the reference frame.
 			const frame& pf = l2.frames[l4_to_l2_mapping[l2_to_l4_mapping.front() - 1]];
@@ -492,20 +531,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 			frames.push_back(frame(f1idx + l2_to_l4_mapping.front(), l1.max_atom_number + pf.rotorY, l1.max_atom_number + pf.rotorX, atoms.size()));
 			frame& f = frames.back();
 
-			// Populate branches.
-			f.branches.reserve(rf_num_branches - 1); // This frame exactly consists of rf_num_branches - 1 BRANCH frames.
-			const size_t b = l4_to_l2_mapping[l2_to_l4_mapping.front() - 1];
-			for (size_t i = 0; i < rf_num_branches; ++i)
-			{
-				if (rf.branches[i] == b) continue;
-				f.branches.push_back(f1_num_frames + l2_to_l4_mapping[rf.branches[i]]);
-			}
-
 			// Populate atoms.
 			for (size_t i = rf.begin; i < rf.end; ++i)
 			{
 				const atom& ra = l2.atoms[i];
-				atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, rot * (ra.coordinate - c2.coordinate) + origin_to_c2, ra.ad));
+				atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, l2_coordinates.get(i), ra.ad));
 			}
 			f.end = atoms.size();
 			assert(f.begin < f.end);
@@ -517,24 +547,16 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 2.
 		const frame& rf = l2.frames[l4_to_l2_mapping[k]];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(f1_num_frames + l2_to_l4_mapping[rf.parent], l1.max_atom_number + rf.rotorX, l1.max_atom_number + rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			f.branches.push_back(f1_num_frames + l2_to_l4_mapping[rf.branches[i]]);
-		}
-
 		// Populate atoms.
 		for (size_t i = rf.begin; i < rf.end; ++i)
 		{
 			const atom& ra = l2.atoms[i];
-			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, rot * (ra.coordinate - c2.coordinate) + origin_to_c2, ra.ad));
+			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, l2_coordinates.get(i), ra.ad));
 		}
 		f.end = atoms.size();
 		assert(f.begin < f.end);
@@ -545,20 +567,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent > f1idx ? l2_num_frames + rf.parent : rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			f.branches.push_back(b > f1idx ? l2_num_frames + b : b);
-		}
-
 		// Populate atoms.
 		for (size_t i = rf.begin; i < rf.end; ++i)
 		{
@@ -598,9 +611,12 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g
 	}
 	assert(mutable_atoms.size() == l1_num_mutatable_atoms + l2_num_mutatable_atoms - 2);
 	assert(mutable_atoms.size() == mutable_atoms.capacity());
+
+	// Index the branches of every frame.
+	index_branches();
 }
 
-ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), parent1(l1.p), num_heavy_atoms(0), num_hb_donors(0), num_hb_acceptors(0), mw(0)
+ligand::ligand(const ligand_id id, const ligand& l1, const size_t f1idx) : id(id), parent1(l1.id), num_heavy_atoms(0), num_hb_donors(0), num_hb_acceptors(0), mw(0), docked(false)
 {
 	const frame& f1 = l1.frames[f1idx];
 
@@ -616,7 +632,7 @@ ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), pare
 
 	// Determine the number of frames of ligand 5. Here, ligand 5 = ligand 1 - ligand 3.
 	size_t child;
-	for (child = f1idx; l1.frames[child].branches.size(); child = l1.frames[child].branches.back());
+	for (child = f1idx; l1.num_branches(child); child = l1.branch(child, l1.num_branches(child) - 1));
 	assert(child < l1_num_frames);
 	const size_t l5_num_frames = child - f1idx + 1;
 	assert(l5_num_frames < l1_num_frames);
@@ -626,20 +642,11 @@ ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), pare
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches);
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			f.branches.push_back(b > f1idx ? b - l5_num_frames : b);
-		}
-
 		// Populate atoms.
 		assert(f.begin == rf.begin);
 		for (size_t i = rf.begin; i < rf.end; ++i)
@@ -655,21 +662,11 @@ ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), pare
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[f1.parent];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches);
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			if (b == f1idx) continue;
-			f.branches.push_back(b > f1idx ? b - l5_num_frames : b);
-		}
-
 		// Populate atoms.
 		assert(f.begin == rf.begin);
 		for (size_t i = rf.begin; i < rf.end; ++i)
@@ -690,7 +687,7 @@ ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), pare
 		assert(m1.srn == f1.rotorY);
 
 		// Set the connector bonds.
-		connector1 = to_string(c1.srn) + ":" + c1.name + " - " + to_string(m1.srn) + ":" + m1.name;
+		connector1 = connector(c1, m1);
 
 		// Add a hydrogen.
 		const array<double, 3> c1_to_c2 = ((c1.covalent_radius() + atom::ad_covalent_radii[0]) / (c1.covalent_radius() + m1.covalent_radius())) * (m1.coordinate - c1.coordinate); // Vector pointing from c1 to the new position of c2.
@@ -705,20 +702,11 @@ ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), pare
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches);
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			f.branches.push_back(b);
-		}
-
 		// Populate atoms.
 		assert(f.begin == rf.begin + 1);
 		for (size_t i = rf.begin; i < rf.end; ++i)
@@ -734,21 +722,11 @@ ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), pare
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent > f1idx ? rf.parent - l5_num_frames : rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			assert(b > f1idx);
-			f.branches.push_back(b - l5_num_frames);
-		}
-
 		// Populate atoms.
 		for (size_t i = rf.begin; i < rf.end; ++i)
 		{
@@ -778,9 +756,12 @@ ligand::ligand(const path& p, const ligand& l1, const size_t f1idx) : p(p), pare
 		mw += a.atomic_weight();
 	}
 	assert(mutable_atoms.size() <= l1.mutable_atoms.size() + 1);
+
+	// Index the branches of every frame.
+	index_branches();
 }
 
-ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t f1idx, const size_t f2idx, const bool dummy) : p(p), parent1(l1.p), parent2(l2.p), num_heavy_atoms(0), num_hb_donors(0), num_hb_acceptors(0), mw(0)
+ligand::ligand(const ligand_id id, const ligand& l1, const ligand& l2, const size_t f1idx, const size_t f2idx, const bool dummy) : id(id), parent1(l1.id), parent2(l2.id), num_heavy_atoms(0), num_hb_donors(0), num_hb_acceptors(0), mw(0), docked(false)
 {
 	const frame& f1 = l1.frames[f1idx];
 	const frame& f2 = l2.frames[f2idx];
@@ -798,11 +779,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t f
 
 	// Determine the number of frames of ligand 5 and ligand 4. Here, ligand 5 = ligand 1 - ligand 3.
 	size_t child;
-	for (child = f1idx; l1.frames[child].branches.size(); child = l1.frames[child].branches.back());
+	for (child = f1idx; l1.num_branches(child); child = l1.branch(child, l1.num_branches(child) - 1));
 	assert(child < l1_num_frames);
 	const size_t l5_num_frames = child - f1idx + 1;
 	assert(l5_num_frames < l1_num_frames);
-	for (child = f2idx; l2.frames[child].branches.size(); child = l2.frames[child].branches.back());
+	for (child = f2idx; l2.num_branches(child); child = l2.branch(child, l2.num_branches(child) - 1));
 	assert(child < l2_num_frames);
 	const size_t l4_num_frames = child - f2idx + 1;
 	assert(l4_num_frames <= l2_num_frames);
@@ -812,20 +793,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t f
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			f.branches.push_back(b > f1idx ? l4_num_frames + b - l5_num_frames : b);
-		}
-
 		// Populate atoms.
 		assert(f.begin == rf.begin);
 		for (size_t i = rf.begin; i < rf.end; ++i)
@@ -861,8 +833,8 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t f
 	assert(m2.srn == f2.rotorX);
 
 	// Set the connector bonds.
-	connector1 = to_string(c1.srn) + ":" + c1.name + " - " + to_string(m1.srn) + ":" + m1.name;
-	connector2 = to_string(c2.srn) + ":" + c2.name + " - " + to_string(m2.srn) + ":" + m2.name;
+	connector1 = connector(c1, m1);
+	connector2 = connector(c2, m2);
 
 	// Calculate the translation vector for moving ligand 2 to a nearby place of ligand 1.
 	const array<double, 3> c1_to_c2 = ((c1.covalent_radius() + c2.covalent_radius()) / (c1.covalent_radius() + m1.covalent_radius())) * (m1.coordinate - c1.coordinate); // Vector pointing from c1 to the new position of c2.
@@ -871,29 +843,31 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t f
 	const array<double, 3> c2_to_m2_nd = normalize(m2.coordinate - c2.coordinate); // Normalized vector pointing from c2 to m2.
 	const array<double, 9> rot = vec3_to_mat3(normalize(cross_product(c2_to_m2_nd, c2_to_c1_nd)), c2_to_m2_nd * c2_to_c1_nd); // Rotation matrix to rotate m2 along the normal to the direction from the new position of c2 to c1.
 
+	// Transform the coordinates of the atoms of ligand 4 in a batch, i.e. rot * (coordinate - c2.coordinate) + origin_to_c2. The frames of ligand 4 are contiguous, and so are their atoms.
+	const size_t l4_begin = f2.begin;
+	const size_t l4_end = l2.frames[f2idx + l4_num_frames - 1].end;
+	soa_coordinates l4_coordinates(l4_end - l4_begin);
+	for (size_t i = l4_begin; i < l4_end; ++i)
+	{
+		l4_coordinates.set(i - l4_begin, l2.atoms[i].coordinate);
+	}
+	transform(l4_coordinates, l4_coordinates, rot, c2.coordinate, origin_to_c2);
+
 	// Create new frames for ligand 2's frames that are either f2 or f2's child frames.
 	for (size_t k = 0; k < l4_num_frames; ++k)
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 2.
 		const frame& rf = l2.frames[f2idx + k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(k ? f1idx + rf.parent - f2idx : f1.parent, k ? l1.max_atom_number + rf.rotorX : f1.rotorX, l1.max_atom_number + rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			f.branches.push_back(f1idx + rf.branches[i] - f2idx);
-		}
-
 		// Populate atoms.
 		for (size_t i = rf.begin; i < rf.end; ++i)
 		{
 			const atom& ra = l2.atoms[i];
-			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, rot * (ra.coordinate - c2.coordinate) + origin_to_c2, ra.ad));
+			atoms.push_back(atom(ra.name, ra.columns_13_to_30, ra.columns_55_to_79, l1.max_atom_number + ra.srn, l4_coordinates.get(i - l4_begin), ra.ad));
 		}
 		f.end = atoms.size();
 		assert(f.begin < f.end);
@@ -904,20 +878,11 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t f
 	{
 		// Obtain a constant reference to the corresponding frame of ligand 1.
 		const frame& rf = l1.frames[k];
-		const size_t rf_num_branches = rf.branches.size();
 
 		// Create a new frame based on the reference frame.
 		frames.push_back(frame(rf.parent > f1idx ? l4_num_frames + rf.parent - l5_num_frames : rf.parent, rf.rotorX, rf.rotorY, atoms.size()));
 		frame& f = frames.back();
 
-		// Populate branches.
-		f.branches.reserve(rf_num_branches); // This frame exactly consists of rf_num_branches BRANCH frames.
-		for (size_t i = 0; i < rf_num_branches; ++i)
-		{
-			const size_t b = rf.branches[i];
-			f.branches.push_back(b > f1idx ? l4_num_frames + b - l5_num_frames : b);
-		}
-
 		// Populate atoms.
 		for (size_t i = rf.begin; i < rf.end; ++i)
 		{
@@ -948,4 +913,7 @@ ligand::ligand(const path& p, const ligand& l1, const ligand& l2, const size_t f
 		mw += a.atomic_weight();
 	}
 	assert(mutable_atoms.size() <= l1.mutable_atoms.size() + l2.mutable_atoms.size());
+
+	// Index the branches of every frame.
+	index_branches();
 }
@@ -2,38 +2,97 @@
 #ifndef IGROW_LIGAND_HPP
 #define IGROW_LIGAND_HPP
 
+#include <cstdint>
+#include <algorithm>
 #include <boost/filesystem/path.hpp>
-#include <boost/flyweight.hpp>
-#include <boost/flyweight/key_value.hpp>
-#include <boost/flyweight/no_tracking.hpp>
 #include "atom.hpp"
 using boost::filesystem::path;
 
 //! Represents a ROOT or a BRANCH in PDBQT structure.
+//! Frames are stored in narrow integer types. Their branches are not stored per frame but indexed per ligand in compressed sparse rows.
 class frame
 {
 public:
-	size_t parent; //!< Frame array index pointing to the parent of current frame. For ROOT frame, this field is not used.
-	size_t rotorX; //!< Serial number of the parent frame atom which forms a rotatable bond with rotorY.
-	size_t rotorY; //!< Serial number of the current frame atom which forms a rotatable bond with rotorX.
-	size_t begin; //!< The inclusive beginning index to the atoms of the current frame.
-	size_t end; //!< The exclusive ending index to the atoms of the current frame.
-	vector<size_t> branches; //!< Indexes to child branches.
+	uint16_t parent; //!< Frame array index pointing to the parent of current frame. For ROOT frame, this field is not used.
+	uint16_t begin; //!< The inclusive beginning index to the atoms of the current frame.
+	uint16_t end; //!< The exclusive ending index to the atoms of the current frame.
+	uint32_t rotorX; //!< Serial number of the parent frame atom which forms a rotatable bond with rotorY.
+	uint32_t rotorY; //!< Serial number of the current frame atom which forms a rotatable bond with rotorX.
+	static const size_t capacity = UINT16_MAX; //!< Maximum number of atoms or frames of a ligand whose indexes fit the narrow fields of frames and branches.
 
 	//! Constructs a frame, and initializes its parent frame, rotor connectors, and beginning atom index.
-	explicit frame(const size_t parent, const size_t rotorX, const size_t rotorY, const size_t begin) : parent(parent), rotorX(rotorX), rotorY(rotorY), begin(begin) {}
+	explicit frame(const size_t parent, const size_t rotorX, const size_t rotorY, const size_t begin) : parent(static_cast<uint16_t>(parent)), begin(static_cast<uint16_t>(begin)), rotorX(static_cast<uint32_t>(rotorX)), rotorY(static_cast<uint32_t>(rotorY)) {}
 };
 
+//! Represents the identity of a ligand, i.e. the generation that creates it and its index among the children of that generation. It is resolved to a path only when the ligand is written out.
+//! Initial ligands belong to generation 0, and fragments to a reserved generation.
+class ligand_id
+{
+public:
+	static const uint32_t fragment_generation = UINT32_MAX; //!< Generation of fragments.
+	static const uint32_t none = UINT32_MAX; //!< Index denoting the absence of a ligand, e.g. of a parent.
+	uint32_t generation; //!< Generation that creates the ligand, 0 for an initial ligand, or fragment_generation for a fragment.
+	uint32_t index; //!< Index of the ligand among the children of its generation, the initial ligands or the fragments, or none.
+
+	//! Constructs an empty identity.
+	explicit ligand_id() : generation(0), index(none) {}
+
+	//! Constructs the identity of the index-th ligand of a generation.
+	explicit ligand_id(const size_t generation, const size_t index) : generation(static_cast<uint32_t>(generation)), index(static_cast<uint32_t>(index)) {}
+
+	//! Returns true if the identity denotes no ligand.
+	bool empty() const
+	{
+		return index == none;
+	}
+
+	//! Returns the identity packed into an integer, e.g. for hashing.
+	uint64_t key() const
+	{
+		return static_cast<uint64_t>(generation) << 32 | index;
+	}
+
+	bool operator==(const ligand_id& id) const
+	{
+		return generation == id.generation && index == id.index;
+	}
+};
+
+//! Represents the bond of a parent broken to connect it to the other parent, i.e. a connector atom and the mutable atom bonded to it, kept as serial numbers and fixed-width names and formatted only when written out.
+class connector
+{
+public:
+	uint32_t c_srn; //!< Serial number of the connector atom, or 0 if there is no connector.
+	uint32_t m_srn; //!< Serial number of the mutable atom.
+	array<char, 4> c_name; //!< Name of the connector atom, padded with null characters.
+	array<char, 4> m_name; //!< Name of the mutable atom, padded with null characters.
+
+	//! Constructs an empty connector.
+	explicit connector() : c_srn(0), m_srn(0), c_name(), m_name() {}
+
+	//! Constructs a connector of a connector atom and a mutable atom.
+	explicit connector(const atom& c, const atom& m) : c_srn(static_cast<uint32_t>(c.srn)), m_srn(static_cast<uint32_t>(m.srn)), c_name(), m_name()
+	{
+		copy_n(c.name.begin(), min<size_t>(c.name.size(), 4), c_name.begin());
+		copy_n(m.name.begin(), min<size_t>(m.name.size(), 4), m_name.begin());
+	}
+};
+
+//! Writes a connector as "srn:name - srn:name", or nothing if it is empty.
+ostream& operator<<(ostream& os, const connector& c);
+
 //! Represents a ligand.
 class ligand
 {
 public:
-	path p; //!< Path to the current ligand.
-	path parent1; //!< Parent ligand 1.
-	path parent2; //!< Parent ligand 2.
-	string connector1; //!< The connecting bond of parent 1.
-	string connector2; //!< The connecting bond of parent 2.
+	ligand_id id; //!< Identity of the current ligand.
+	ligand_id parent1; //!< Parent ligand 1.
+	ligand_id parent2; //!< Parent ligand 2, or the fragment of a child created by addition.
+	connector connector1; //!< The connecting bond of parent 1.
+	connector connector2; //!< The connecting bond of parent 2.
 	vector<frame> frames; //!< Frames.
+	vector<uint16_t> branch_offsets; //!< Offsets of the branches of every frame into branch_frames, followed by the total number of branches.
+	vector<uint16_t> branch_frames; //!< Indexes to the child branches of all the frames, grouped by parent frame in ascending order.
 	vector<atom> atoms; //!< Atoms.
 	vector<size_t> mutable_atoms; //!< Hydrogens or halogens.
 	size_t max_atom_number; //!< Maximum atom serial number.
@@ -44,27 +103,56 @@ public:
 	size_t num_hb_acceptors; //!< Number of hydrogen bond acceptors.
 	double mw; //!< Molecular weight.
 	double fe; //!< Predicted free energy obtained by external docking.
-	explicit ligand() {}
+	bool docked; //!< True if the free energy has been obtained by docking or a stand-in for it. Children left undocked have a free energy of 0 and are never preferred to docked ligands.
+	explicit ligand() : docked(false) {}
 
 	//! Constructs a ligand by parsing a given ligand file in PDBQT.
 	//! @exception parsing_error Thrown when error parsing the ligand file.
 	explicit ligand(const path& p);
 
+	//! Constructs a ligand by parsing PDBQT from an input stream, e.g. an in-memory string, naming it by a given path in parsing errors.
+	//! @exception parsing_error Thrown when error parsing the ligand.
+	explicit ligand(istream& is, const path& p);
+
 	//! Constructs a ligand by addition.
-	explicit ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g1, const size_t g2);
+	explicit ligand(const ligand_id id, const ligand& l1, const ligand& l2, const size_t g1, const size_t g2);
 
 	//! Constructs a ligand by subtraction.
-	explicit ligand(const path& p, const ligand& l1, const size_t g1);
+	explicit ligand(const ligand_id id, const ligand& l1, const size_t g1);
 
 	//! Constructs a ligand by crossover.
-	explicit ligand(const path& p, const ligand& l1, const ligand& l2, const size_t g1, const size_t g2, const bool dummy);
+	explicit ligand(const ligand_id id, const ligand& l1, const ligand& l2, const size_t g1, const size_t g2, const bool dummy);
+
+	//! Saves the current ligand to a given file in PDBQT format.
+	void save(const path& p) const;
 
-	//! Saves the current ligand to a file in PDBQT format.
-	void save() const;
+	//! Writes the current ligand to an output stream in PDBQT format.
+	void save(ostream& os) const;
 
-	//! Parse the docked ligand to obtain predicted free energy and docked coordinates.
+	//! Parse the docked ligand to obtain predicted free energy and docked coordinates, or mark the current ligand undocked with free energy 0 if it was not docked.
 	void update(const path& p);
 
+	//! Returns the predicted free energy of a docked ligand, or 0 if it was not docked.
+	static double docked_fe(const path& p);
+
+	//! Returns the number of branches of the k-th frame.
+	size_t num_branches(const size_t k) const
+	{
+		return branch_offsets[k + 1] - branch_offsets[k];
+	}
+
+	//! Returns the frame index of the j-th branch of the k-th frame.
+	size_t branch(const size_t k, const size_t j) const
+	{
+		return branch_frames[branch_offsets[k] + j];
+	}
+
+	//! Releases the structure of the current ligand, i.e. its frames and atoms, keeping its properties.
+	void shed();
+
+	//! Restores the structure of the current ligand from a ligand file in PDBQT, keeping its properties.
+	void rehydrate(const path& p);
+
 	//! Gets the frame and index to which a atom belongs to given its serial number.
 	pair<size_t, size_t> get_frame(const size_t srn) const;
 
@@ -86,31 +174,56 @@ public:
 		return num_rotatable_bonds > 0;
 	}
 
-	//! Compares the efficacy of the current ligand and the other ligand for sorting ptr_vector<ligand>.
+	//! Compares the efficacy of the current ligand and the other ligand for sorting ptr_vector<ligand>, ranking undocked ligands after all docked ones.
 	bool operator<(const ligand& l) const
 	{
-		return fe < l.fe;
+		return docked && (!l.docked || fe < l.fe);
 	}
+
+private:
+	//! Parses the frames and atoms of the ligand from PDBQT, naming it by a given path in parsing errors.
+	void parse(istream& is, const path& p);
+
+	//! Indexes the branches of every frame from the parents of the frames by a counting sort, so that the branches of a frame are in ascending order.
+	void index_branches();
 };
 
-//! For extracting the path out of a ligand.
-class ligand_path_extractor
+//! Represents a resolver of ligand identities to paths, i.e. the paths the initial ligands and the fragments are parsed from, and folder/generation/subfolder/index+1.pdbqt for children, or folder/generation+extension:index+1.pdbqt for children packed into archives.
+class path_resolver
 {
 public:
-	const path& operator()(const ligand& l) const
+	//! Constructs a resolver of children saved into the subfolder of the generation folders in a folder, or into the archives of the generations in a folder if an archive extension is given, and of initial ligands and fragments parsed from given paths.
+	explicit path_resolver(const path& folder, const path& subfolder, const vector<path>& initial_paths, const vector<path>& fragment_paths, const string& archive_extension = string()) : folder(folder), subfolder(subfolder), initial_paths(initial_paths), fragment_paths(fragment_paths), archive_extension(archive_extension) {}
+
+	//! Returns the path of a ligand, or an empty path if the identity is empty.
+	path operator()(const ligand_id& id) const
 	{
-		return l.p;
+		if (id.empty()) return path();
+		if (id.generation == ligand_id::fragment_generation) return fragment_paths[id.index];
+		if (!id.generation) return initial_paths[id.index];
+		if (!archive_extension.empty()) return path((folder / (to_string(id.generation) + archive_extension)).string() + ':' + to_string(id.index + 1) + ".pdbqt");
+		return folder / to_string(id.generation) / subfolder / (to_string(id.index + 1) + ".pdbqt");
 	}
-};
 
-//! Define flyweight type for ligand.
-using namespace boost::flyweights;
-typedef	flyweight<key_value<path, ligand, ligand_path_extractor>, no_tracking> ligand_flyweight;
+private:
+	const path folder; //!< Folder of the generation folders.
+	const path subfolder; //!< Subfolder of a generation folder into which children are saved.
+	const vector<path> initial_paths; //!< Paths to the initial ligands.
+	const vector<path> fragment_paths; //!< Paths to the fragments.
+	const string archive_extension; //!< Extension of the archives into which children are packed, or empty if children are saved into files.
+};
 
 //! Represents a ligand validator.
 class validator
 {
 public:
+	const size_t max_rotatable_bonds; //!< Maximum number of rotatable bonds.
+	const size_t max_atoms; //!< Maximum number of atoms.
+	const size_t max_heavy_atoms; //!< Maximum number of heavy atoms.
+	const size_t max_hb_donors; //!< Maximum number of hydrogen bond donors.
+	const size_t max_hb_acceptors; //!< Maximum number of hydrogen bond acceptors.
+	const double max_mw; //!< Maximum molecular weight.
+
 	validator(const size_t max_rotatable_bonds, const size_t max_atoms, const size_t max_heavy_atoms, const size_t max_hb_donors, const size_t max_hb_acceptors, const double max_mw) : max_rotatable_bonds(max_rotatable_bonds), max_atoms(max_atoms), max_heavy_atoms(max_heavy_atoms), max_hb_donors(max_hb_donors), max_hb_acceptors(max_hb_acceptors), max_mw(max_mw) {}
 
 	bool operator()(const ligand& l) const
@@ -123,14 +236,6 @@ public:
 		if (l.mw > max_mw) return false;
 		return true;
 	}
-
-private:
-	const size_t max_rotatable_bonds;
-	const size_t max_atoms;
-	const size_t max_heavy_atoms;
-	const size_t max_hb_donors;
-	const size_t max_hb_acceptors;
-	const double max_mw;
 };
 
 #endif
@@ -0,0 +1,85 @@
+#include "lineage.hpp"
+
+const uint32_t lineage_node::none;
+const uint32_t lineage_node::ligand_kind;
+const uint32_t lineage_node::fragment_kind;
+
+lineage_writer::lineage_writer(const path& p, const path_resolver& resolve) : nodes(p, ios::binary), names(path(p.string() + ".names"), ios::binary), resolve(resolve), name_offset(0), num_nodes(0)
+{
+}
+
+void lineage_writer::append(lineage_node n, const ligand_id& id)
+{
+	const string name = resolve(id).string();
+	ids.insert(make_pair(id.key(), num_nodes++));
+	n.name_offset = name_offset;
+	nodes.write(reinterpret_cast<const char*>(&n), sizeof(n));
+	names << name << '\n';
+	name_offset += name.size() + 1;
+}
+
+uint32_t lineage_writer::intern(const ligand_id& id, const size_t generation)
+{
+	const auto i = ids.find(id.key());
+	if (i != ids.end()) return i->second;
+	const uint32_t node = num_nodes;
+	append({ id.generation == ligand_id::fragment_generation ? lineage_node::fragment_kind : lineage_node::ligand_kind, static_cast<uint32_t>(generation), lineage_node::none, lineage_node::none, lineage_node::none, 0, 0 }, id);
+	return node;
+}
+
+void lineage_writer::write(const size_t generation, const ligand& l)
+{
+	if (ids.count(l.id.key())) return;
+
+	// Intern the parents first. Parent 2 is an elite for crossover, or otherwise a fragment.
+	lineage_node n = { lineage_node::ligand_kind, static_cast<uint32_t>(generation), lineage_node::none, lineage_node::none, lineage_node::none, static_cast<float>(l.fe), 0 };
+	if (!l.parent1.empty()) n.parent1 = intern(l.parent1, generation);
+	if (!l.parent2.empty())
+	{
+		if (l.parent2.generation == ligand_id::fragment_generation) n.fragment = intern(l.parent2, generation);
+		else n.parent2 = intern(l.parent2, generation);
+	}
+
+	// Append the node of the ligand itself.
+	append(n, l.id);
+}
+
+void lineage_writer::flush()
+{
+	nodes.flush();
+	names.flush();
+}
+
+lineage_reader::lineage_reader(const path& p) : names(path(p.string() + ".names"), ios::binary)
+{
+	boost::filesystem::ifstream ifs(p, ios::binary);
+	if (!ifs) throw domain_error("Failed to open lineage store " + p.string());
+	ifs.seekg(0, ios::end);
+	nodes.resize(static_cast<size_t>(ifs.tellg()) / sizeof(lineage_node));
+	ifs.seekg(0);
+	ifs.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(lineage_node));
+	if (!names) throw domain_error("Failed to open names of lineage store " + p.string());
+
+	// Index the names once, which are newline-terminated in the order of the nodes.
+	ids.reserve(nodes.size());
+	string s;
+	for (uint32_t id = 0; id < nodes.size() && getline(names, s); ++id)
+	{
+		ids.insert(make_pair(s, id));
+	}
+}
+
+string lineage_reader::name(const uint32_t id)
+{
+	names.clear();
+	names.seekg(nodes[id].name_offset);
+	string s;
+	getline(names, s);
+	return s;
+}
+
+uint32_t lineage_reader::find(const string& name) const
+{
+	const auto i = ids.find(name);
+	return i == ids.end() ? lineage_node::none : i->second;
+}
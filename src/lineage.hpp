@@ -0,0 +1,75 @@
+#pragma once
+#ifndef IGROW_LINEAGE_HPP
+#define IGROW_LINEAGE_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include "ligand.hpp"
+#include <boost/filesystem/fstream.hpp>
+
+//! Represents a node of the lineage store, i.e. a ligand or a fragment, identified by its index in the store.
+//! Nodes are written in the order they are first mentioned, so parents always precede their children.
+class lineage_node
+{
+public:
+	static const uint32_t none = UINT32_MAX; //!< Identity denoting the absence of a parent or a fragment.
+	static const uint32_t ligand_kind = 0; //!< Kind of a ligand node.
+	static const uint32_t fragment_kind = 1; //!< Kind of a fragment node.
+	uint32_t kind; //!< Kind of the node.
+	uint32_t generation; //!< Generation in which the node first appears.
+	uint32_t parent1; //!< Identity of parent 1, or none for an initial ligand or a fragment.
+	uint32_t parent2; //!< Identity of parent 2 of a child created by crossover, or none.
+	uint32_t fragment; //!< Identity of the fragment of a child created by addition, or none.
+	float fe; //!< Predicted free energy of the ligand when it first appears.
+	uint64_t name_offset; //!< Offset of the path of the node in the names file.
+};
+
+//! Represents a writer of a lineage store, which consists of a file of fixed-size nodes and a names file of newline-terminated paths, i.e. the store path with .names appended.
+class lineage_writer
+{
+public:
+	//! Creates a lineage store for writing, naming the nodes by the paths to which a resolver resolves the identities of ligands and fragments.
+	explicit lineage_writer(const path& p, const path_resolver& resolve);
+
+	//! Records a ligand of a generation, together with its parents and fragment if they are not yet recorded. A ligand already recorded, e.g. a surviving elite, is skipped.
+	void write(const size_t generation, const ligand& l);
+
+	//! Flushes the store so that it can be queried while the run continues.
+	void flush();
+
+private:
+	boost::filesystem::ofstream nodes; //!< Node stream.
+	boost::filesystem::ofstream names; //!< Names stream.
+	const path_resolver& resolve; //!< Resolver of the paths of ligands and fragments.
+	uint64_t name_offset; //!< Current offset in the names file.
+	unordered_map<uint64_t, uint32_t> ids; //!< Node identities of the recorded ligands and fragments keyed by their packed ligand identities.
+	uint32_t num_nodes; //!< Number of recorded nodes.
+
+	//! Returns the node identity of a ligand or a fragment, recording a new node if it is not yet recorded.
+	uint32_t intern(const ligand_id& id, const size_t generation);
+
+	//! Appends a node, naming it by the path of a ligand or a fragment.
+	void append(lineage_node n, const ligand_id& id);
+};
+
+//! Represents a reader of a lineage store.
+class lineage_reader
+{
+public:
+	vector<lineage_node> nodes; //!< Nodes indexed by identity.
+
+	//! Reads a lineage store and indexes the identities of its nodes by their paths.
+	explicit lineage_reader(const path& p);
+
+	//! Returns the path of a node.
+	string name(const uint32_t id);
+
+	//! Returns the identity of a path, or none if it is not recorded.
+	uint32_t find(const string& name) const;
+
+private:
+	boost::filesystem::ifstream names; //!< Names stream.
+	unordered_map<string, uint32_t> ids; //!< Node identities keyed by their paths.
+};
+
+#endif
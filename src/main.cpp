@@ -3,46 +3,153 @@
 #include <iomanip>
 #include <thread>
 #include <random>
+#include <future>
+#include <sstream>
+#include <queue>
+#include <algorithm>
+#include <limits>
 #include <boost/program_options.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/fstream.hpp>
-#include <boost/ptr_container/ptr_vector.hpp>
-#include <boost/process.hpp>
+#include <boost/process/search_path.hpp>
 #include "io_service_pool.hpp"
 #include "safe_counter.hpp"
 #include "ligand.hpp"
+#include "scoring_function.hpp"
+#include "surrogate.hpp"
+#include "prefilter.hpp"
+#include "optimizer.hpp"
+#include "docker.hpp"
+#include "scheduler.hpp"
+#include "archive.hpp"
+#include "fragment_cache.hpp"
+#include "fragment_index.hpp"
+#include "fragment_scores.hpp"
+#include "lineage.hpp"
+#include "telemetry.hpp"
+#include "benchmark.hpp"
+#include "budget.hpp"
+#include "grower.hpp"
 using namespace boost;
 using namespace boost::filesystem;
-using namespace boost::process;
-using namespace boost::process::initializers;
+
+//! Represents a row of the initial generation csv that is a candidate initial elite ligand.
+class initial_ligand
+{
+public:
+	double fe; //!< Predicted free energy.
+	size_t row; //!< Row number in the csv.
+	string name; //!< Ligand name, i.e. the filename without the .pdbqt extension.
+
+	explicit initial_ligand() {}
+	explicit initial_ligand(const double fe, const size_t row, const string& name) : fe(fe), row(row), name(name) {}
+
+	//! Orders candidates by free energy and then by row, so that the top of a max-heap is the worst kept candidate.
+	bool operator<(const initial_ligand& l) const
+	{
+		return fe < l.fe || (fe == l.fe && row < l.row);
+	}
+};
+
+//! Represents a folder private to the current run, which is removed together with its content when it goes out of scope, so that it is cleaned up on every exit path.
+class private_folder
+{
+public:
+	const path p; //!< Path to the folder, or empty if none.
+
+	explicit private_folder(const path& p) : p(p) {}
+
+	~private_folder()
+	{
+		boost::system::error_code ec;
+		if (!p.empty()) remove_all(p, ec);
+	}
+};
+
+//! Parses the receptor and the box from an idock configuration file, reporting an invalid receptor or box to the standard error.
+//! @return false if the receptor is not a regular file or the box is empty in a dimension.
+static bool parse_receptor(const path& idock_config_path, path& receptor_path, std::array<double, 3>& center, std::array<double, 3>& span)
+{
+	using namespace boost::program_options;
+	options_description idock_options;
+	idock_options.add_options()
+		("receptor", value<path>(&receptor_path)->required())
+		("center_x", value<double>(&center[0])->required())
+		("center_y", value<double>(&center[1])->required())
+		("center_z", value<double>(&center[2])->required())
+		("size_x", value<double>(&span[0])->required())
+		("size_y", value<double>(&span[1])->required())
+		("size_z", value<double>(&span[2])->required())
+		;
+	variables_map idock_vm;
+	boost::filesystem::ifstream idock_config_file(idock_config_path);
+	store(parse_config_file(idock_config_file, idock_options, true), idock_vm);
+	idock_vm.notify();
+	if (!is_regular_file(receptor_path))
+	{
+		cerr << "Receptor " << receptor_path << " specified in idock configuration file " << idock_config_path << " is not a regular file" << endl;
+		return false;
+	}
+	if (span[0] <= 0 || span[1] <= 0 || span[2] <= 0)
+	{
+		cerr << "Box size specified in idock configuration file " << idock_config_path << " must be positive in every dimension" << endl;
+		return false;
+	}
+	return true;
+}
 
 int main(int argc, char* argv[])
 {
 	// Initialize the default path to log files. They will be reused when calling idock.
 	const path default_log_path = "log.csv";
 
-	path initial_generation_csv_path, initial_generation_folder_path, fragment_folder_path, idock_config_path, output_folder_path, log_path;
-	size_t num_threads, seed, num_elitists, num_additions, num_subtractions, num_crossovers, max_failures, max_rotatable_bonds, max_atoms, max_heavy_atoms, max_hb_donors, max_hb_acceptors;
-	double max_mw;
+	path initial_generation_csv_path, initial_generation_folder_path, fragment_folder_path, idock_config_path, output_folder_path, log_path, grid_cache_path, receptor_path, staging_folder_path, telemetry_path, broker_path;
+	size_t num_threads, seed, num_elitists, num_additions, num_subtractions, num_crossovers, max_failures, max_rotatable_bonds, max_atoms, max_heavy_atoms, max_hb_donors, max_hb_acceptors, num_candidates, num_docking_jobs, max_retries, fragment_cache_capacity, num_screen_tasks, max_dockings, patience;
+	double max_mw, granularity, max_overlap, max_similarity, straggler_factor, dock_margin, redock_fraction, redock_margin, max_seconds, max_cpu_seconds, tolerance, fragment_temperature;
+	bool prefiltering, archiving, compressing, large_population, warm_starting, tabu_searching;
+	std::future<void> trash; // Removes the previous output folder in the background.
+	std::array<double, 3> center, span;
 
 	// Process program options.
 	try
 	{
 		// Initialize the default values of optional arguments.
 		const path default_output_folder_path = "output";
+		const path default_grid_cache_path = "grid_cache";
 		const size_t default_num_threads = thread::hardware_concurrency();
-		const size_t default_seed = chrono::system_clock::now().time_since_epoch().count();
+		const size_t default_seed = std::chrono::system_clock::now().time_since_epoch().count();
 		const size_t default_num_additions = 20;
 		const size_t default_num_subtractions = 20;
 		const size_t default_num_crossovers = 20;
 		const size_t default_num_elitists = 10;
 		const size_t default_max_failures = 1000;
+		const double default_max_seconds = 0;
+		const size_t default_max_dockings = 0;
+		const double default_max_cpu_seconds = 0;
+		const size_t default_patience = 0;
+		const double default_tolerance = 0.1;
 		const size_t default_max_rotatable_bonds = 30;
 		const size_t default_max_atoms = 100;
 		const size_t default_max_heavy_atoms = 80;
 		const size_t default_max_hb_donors = 5;
 		const size_t default_max_hb_acceptors = 10;
 		const double default_max_mw = 500;
+		const size_t default_num_candidates = 1;
+		const double default_granularity = 0.375;
+		const double default_max_overlap = 1.5;
+		const double default_max_similarity = 1;
+		const double default_fragment_temperature = 0;
+		const size_t default_num_docking_jobs = 1;
+		const size_t default_max_retries = 0;
+		const double default_straggler_factor = 0;
+		const double default_dock_margin = 0.5;
+		const size_t default_num_screen_tasks = 0;
+		const double default_redock_fraction = 0.2;
+		const double default_redock_margin = 1;
+		const size_t default_fragment_cache_capacity = 0;
+		const size_t default_num_benchmark_generations = 10;
+		const path default_benchmark_fragment_folder_path = "fragments";
+		const size_t default_benchmark_seed = 1;
 
 		using namespace boost::program_options;
 		options_description input_options("input (required)");
@@ -57,23 +164,53 @@ int main(int argc, char* argv[])
 		output_options.add_options()
 			("output_folder", value<path>(&output_folder_path)->default_value(default_output_folder_path), "folder of output results")
 			("log", value<path>(&log_path)->default_value(default_log_path), "log file in csv format")
+			("staging_folder", value<path>(&staging_folder_path), "folder on a memory-backed file system, e.g. /dev/shm, in a private subfolder of which docking input and output are staged")
+			("archive", bool_switch(&archiving), "pack the docked ligands of each generation into one archive with an offset index")
+			("compress", bool_switch(&compressing), "compress archives with gzip")
+			("telemetry", value<path>(&telemetry_path), "csv file of allocation counts and bytes per phase, resident set sizes and the resident size of the fragment cache per generation")
 			;
 
 		options_description miscellaneous_options("options (optional)");
 		miscellaneous_options.add_options()
 			("threads", value<size_t>(&num_threads)->default_value(default_num_threads), "number of worker threads to use")
+			("docking_jobs", value<size_t>(&num_docking_jobs)->default_value(default_num_docking_jobs), "number of concurrent idock jobs per generation, balanced by a learned runtime model and pinned to disjoint CPU sets")
+			("max_retries", value<size_t>(&max_retries)->default_value(default_max_retries), "maximum number of times a ligand left undocked by a failed or killed idock job is requeued before it is quarantined, 0 to fail the run on a failed idock job unless jobs are split or stragglers are killed")
+			("straggler_factor", value<double>(&straggler_factor)->default_value(default_straggler_factor), "factor of the predicted wall time of an idock job beyond which it is killed as a straggler, 0 to disable")
+			("broker", value<path>(&broker_path), "Unix domain socket of an igrow-broker daemon to submit idock jobs to instead of running idock directly")
+			("screen_tasks", value<size_t>(&num_screen_tasks)->default_value(default_num_screen_tasks), "number of Monte Carlo tasks of idock for screening every child at reduced effort with one conformation before re-docking the promising ones at full effort, 0 to dock every child once at full effort")
+			("redock_fraction", value<double>(&redock_fraction)->default_value(default_redock_fraction), "fraction of the screened children with the best free energies to re-dock at full effort")
+			("redock_margin", value<double>(&redock_margin)->default_value(default_redock_margin), "margin in kcal/mol over the free energy of the worst elite within which a screened child is also re-docked at full effort")
+			("fragment_cache", value<size_t>(&fragment_cache_capacity)->default_value(default_fragment_cache_capacity), "maximum number of parsed fragments kept in memory with least recently used eviction, 0 for unbounded")
 			("seed", value<size_t>(&seed)->default_value(default_seed), "explicit non-negative random seed")
 			("elitists", value<size_t>(&num_elitists)->default_value(default_num_elitists), "number of elite ligands to carry over")
 			("additions", value<size_t>(&num_additions)->default_value(default_num_additions), "number of child ligands created by addition")
 			("subtractions", value<size_t>(&num_subtractions)->default_value(default_num_subtractions), "number of child ligands created by subtraction")
 			("crossovers", value<size_t>(&num_crossovers)->default_value(default_num_crossovers), "number of child ligands created by crossover")
 			("max_failures", value<size_t>(&max_failures)->default_value(default_max_failures), "maximum number of operational failures to tolerate")
+			("max_seconds", value<double>(&max_seconds)->default_value(default_max_seconds), "wall-clock budget of the run in seconds, within which the children of the last generation are docked in priority order and beyond which idock jobs are killed, 0 for no limit")
+			("max_dockings", value<size_t>(&max_dockings)->default_value(default_max_dockings), "budget of the run in number of dockings, 0 for no limit")
+			("max_cpu_seconds", value<double>(&max_cpu_seconds)->default_value(default_max_cpu_seconds), "budget of the run in CPU seconds of igrow and the idock processes it runs, excluding brokered idock jobs, 0 for no limit")
+			("patience", value<size_t>(&patience)->default_value(default_patience), "number of consecutive generations without improvement of the average free energy of elites after which the run stops, 0 to disable")
+			("tolerance", value<double>(&tolerance)->default_value(default_tolerance), "minimum decrease in kcal/mol of the average free energy of elites counted as an improvement")
 			("max_rotatable_bonds", value<size_t>(&max_rotatable_bonds)->default_value(default_max_rotatable_bonds), "maximum number of rotatable bonds")
 			("max_atoms", value<size_t>(&max_atoms)->default_value(default_max_atoms), "maximum number of atoms")
 			("max_heavy_atoms", value<size_t>(&max_heavy_atoms)->default_value(default_max_heavy_atoms), "maximum number of heavy atoms")
 			("max_hb_donors", value<size_t>(&max_hb_donors)->default_value(default_max_hb_donors), "maximum number of hydrogen bond donors")
 			("max_hb_acceptors", value<size_t>(&max_hb_acceptors)->default_value(default_max_hb_acceptors), "maximum number of hydrogen bond acceptors")
 			("max_mw", value<double>(&max_mw)->default_value(default_max_mw), "maximum molecular weight")
+			("prescreen", value<size_t>(&num_candidates)->default_value(default_num_candidates), "number of candidates to pre-screen by surrogate scoring per child, 1 to disable")
+			("grid_cache", value<path>(&grid_cache_path)->default_value(default_grid_cache_path), "folder of cached surrogate scoring grids and docked free energies of fragments")
+			("granularity", value<double>(&granularity)->default_value(default_granularity), "density of probe atoms of surrogate scoring grids")
+			("warm_start", bool_switch(&warm_starting), "refine the torsion of the new bond and the rigid-body pose of children created by addition against the surrogate scoring grid, docking only the promising ones")
+			("dock_margin", value<double>(&dock_margin)->default_value(default_dock_margin), "margin in kcal/mol over the free energy of the worst elite within which a warm-started child is promising enough to dock")
+			("prefilter", bool_switch(&prefiltering), "reject children whose heavy atoms leave the box or clash with the receptor")
+			("max_overlap", value<double>(&max_overlap)->default_value(default_max_overlap), "maximum overlap in angstroms tolerated between heavy atoms of children and receptor")
+			("fragment_temperature", value<double>(&fragment_temperature)->default_value(default_fragment_temperature), "temperature in kcal/mol of the Boltzmann weights by which addition samples fragments, docked once against the receptor and cached in the grid cache folder, 0 for uniform sampling")
+			("max_similarity", value<double>(&max_similarity)->default_value(default_max_similarity), "maximum Tanimoto similarity of fingerprints of children to elites and earlier siblings, 1 to disable")
+			("tabu", bool_switch(&tabu_searching), "memorize the operations on surviving elites that produced invalid or clashing children, and skip them when sampling")
+			("large_population", bool_switch(&large_population), "scale to 10^5 or more ligands per generation by shedding the structures of non-elite ligands and selecting elites by partial sorting")
+			("benchmark", bool_switch(), "measure the scaling of child construction with the number of threads up to --threads, growing the fragments by the requested creation stages with a synthetic score instead of docking, and exit")
+			("benchmark_generations", value<size_t>()->default_value(default_num_benchmark_generations), "number of generations to run per thread count in benchmark mode")
 			("help", "help information")
 			("version", "version information")
 			("config", value<path>(), "options can be loaded from a configuration file")
@@ -114,6 +251,74 @@ int main(int argc, char* argv[])
 			store(parse_config_file(config_file, all_options), vm);
 		}
 
+		// Run the benchmark if requested, which needs none of the input options but the idock configuration file for the stages that score children against the receptor. The fragment folder defaults to the bundled one and the seed is fixed unless given explicitly.
+		if (vm["benchmark"].as<bool>())
+		{
+			const size_t benchmark_threads = vm["threads"].as<size_t>();
+			grower::options stages;
+			stages.num_candidates = vm["prescreen"].as<size_t>();
+			stages.tabu_searching = vm["tabu"].as<bool>();
+			stages.max_similarity = vm["max_similarity"].as<double>();
+			stages.large_population = vm["large_population"].as<bool>();
+			const bool benchmark_warm_starting = vm["warm_start"].as<bool>();
+			const bool benchmark_prefiltering = vm["prefilter"].as<bool>();
+			if (!benchmark_threads)
+			{
+				cerr << "Option threads must be 1 or greater" << endl;
+				return 1;
+			}
+			if (!stages.num_candidates)
+			{
+				cerr << "Option prescreen must be 1 or greater" << endl;
+				return 1;
+			}
+			if (vm["granularity"].as<double>() <= 0)
+			{
+				cerr << "Option granularity must be positive" << endl;
+				return 1;
+			}
+			if (vm["max_overlap"].as<double>() < 0)
+			{
+				cerr << "Option max_overlap must be non-negative" << endl;
+				return 1;
+			}
+			if (stages.max_similarity <= 0 || stages.max_similarity > 1)
+			{
+				cerr << "Option max_similarity must be positive and not greater than 1" << endl;
+				return 1;
+			}
+
+			// Map the surrogate scoring grid and hash the receptor as a real run does, so that pre-screening, warm starting and prefiltering are timed as part of creation.
+			unique_ptr<surrogate> sg;
+			unique_ptr<optimizer> opt;
+			unique_ptr<prefilter> pf;
+			unique_ptr<box> b;
+			if (stages.num_candidates > 1 || benchmark_warm_starting || benchmark_prefiltering)
+			{
+				if (!vm.count("idock_config"))
+				{
+					cerr << "Option idock_config is required to benchmark pre-screening, warm starting or prefiltering" << endl;
+					return 1;
+				}
+				if (!parse_receptor(vm["idock_config"].as<path>(), receptor_path, center, span)) return 1;
+				b.reset(new box(center, span, vm["granularity"].as<double>()));
+				if (stages.num_candidates > 1 || benchmark_warm_starting)
+				{
+					io_service_pool io(benchmark_threads);
+					sg.reset(new surrogate(receptor_path, *b, vm["grid_cache"].as<path>(), io));
+					io.wait();
+				}
+				if (benchmark_warm_starting) opt.reset(new optimizer(*sg));
+				if (benchmark_prefiltering) pf.reset(new prefilter(receptor_path, *b, vm["max_overlap"].as<double>()));
+			}
+			stages.sg = sg.get();
+			stages.opt = opt.get();
+			stages.pf = pf.get();
+
+			const validator v(vm["max_rotatable_bonds"].as<size_t>(), vm["max_atoms"].as<size_t>(), vm["max_heavy_atoms"].as<size_t>(), vm["max_hb_donors"].as<size_t>(), vm["max_hb_acceptors"].as<size_t>(), vm["max_mw"].as<double>());
+			return benchmark(vm.count("fragment_folder") ? vm["fragment_folder"].as<path>() : default_benchmark_fragment_folder_path, v, stages, b.get(), vm["fragment_cache"].as<size_t>(), vm["elitists"].as<size_t>(), vm["additions"].as<size_t>(), vm["subtractions"].as<size_t>(), vm["crossovers"].as<size_t>(), vm["max_failures"].as<size_t>(), vm["seed"].defaulted() ? default_benchmark_seed : vm["seed"].as<size_t>(), benchmark_threads, vm["benchmark_generations"].as<size_t>());
+		}
+
 		// Notify the user of parsing errors, if any.
 		vm.notify();
 
@@ -165,14 +370,35 @@ int main(int argc, char* argv[])
 			return 1;
 		}
 
-		// Validate output folder.
-		remove_all(output_folder_path);
+		// Validate output folder. A previous output folder is moved aside and removed in the background, as it may consist of millions of files.
+		if (exists(output_folder_path))
+		{
+			path trash_path(output_folder_path);
+			trash_path.remove_trailing_separator();
+			trash_path += unique_path(".%%%%-%%%%.trash");
+			rename(output_folder_path, trash_path);
+			trash = std::async(std::launch::async, [trash_path]()
+			{
+				remove_all(trash_path);
+			});
+		}
 		if (!create_directories(output_folder_path))
 		{
 			cerr << "Failed to create output folder " << output_folder_path << endl;
 			return 1;
 		}
 
+		// Validate staging folder, which may be shared with other runs and is therefore never cleared.
+		if (!staging_folder_path.empty())
+		{
+			create_directories(staging_folder_path);
+			if (!is_directory(staging_folder_path))
+			{
+				cerr << "Failed to create staging folder " << staging_folder_path << endl;
+				return 1;
+			}
+		}
+
 		// Validate log_path.
 		if (is_directory(log_path))
 		{
@@ -180,17 +406,87 @@ int main(int argc, char* argv[])
 			return 1;
 		}
 
+		// Validate docking broker.
+		if (!broker_path.empty() && !exists(broker_path))
+		{
+			cerr << "Docking broker socket " << broker_path << " does not exist" << endl;
+			return 1;
+		}
+
 		// Validate miscellaneous options.
 		if (!num_threads)
 		{
 			cerr << "Option threads must be 1 or greater" << endl;
 			return 1;
 		}
+		if (!num_docking_jobs)
+		{
+			cerr << "Option docking_jobs must be 1 or greater" << endl;
+			return 1;
+		}
+		if (redock_fraction < 0 || redock_fraction > 1)
+		{
+			cerr << "Option redock_fraction must be between 0 and 1" << endl;
+			return 1;
+		}
+		if (redock_margin < 0)
+		{
+			cerr << "Option redock_margin must be non-negative" << endl;
+			return 1;
+		}
+		if (max_seconds < 0)
+		{
+			cerr << "Option max_seconds must be non-negative" << endl;
+			return 1;
+		}
+		if (max_cpu_seconds < 0)
+		{
+			cerr << "Option max_cpu_seconds must be non-negative" << endl;
+			return 1;
+		}
+		if (tolerance < 0)
+		{
+			cerr << "Option tolerance must be non-negative" << endl;
+			return 1;
+		}
+		if (straggler_factor < 0)
+		{
+			cerr << "Option straggler_factor must be non-negative" << endl;
+			return 1;
+		}
 		if (max_mw <= 0)
 		{
 			cerr << "Option max_mw must be positive" << endl;
 			return 1;
 		}
+		if (!num_candidates)
+		{
+			cerr << "Option prescreen must be 1 or greater" << endl;
+			return 1;
+		}
+		if (granularity <= 0)
+		{
+			cerr << "Option granularity must be positive" << endl;
+			return 1;
+		}
+		if (fragment_temperature < 0)
+		{
+			cerr << "Option fragment_temperature must be non-negative" << endl;
+			return 1;
+		}
+		if (max_overlap < 0)
+		{
+			cerr << "Option max_overlap must be non-negative" << endl;
+			return 1;
+		}
+		if (max_similarity <= 0 || max_similarity > 1)
+		{
+			cerr << "Option max_similarity must be positive and not greater than 1" << endl;
+			return 1;
+		}
+
+		// Parse the receptor and the box from the idock configuration file if surrogate scoring, warm starting, prefiltering or fragment weighting is requested.
+		if ((num_candidates > 1 || warm_starting || prefiltering || fragment_temperature > 0) && !parse_receptor(idock_config_path, receptor_path, center, span)) return 1;
 	}
 	catch (const std::exception& e)
 	{
@@ -198,37 +494,119 @@ int main(int argc, char* argv[])
 		return 1;
 	}
 
+	// Stage in a private subfolder of the staging folder, so that concurrent runs sharing it do not interfere, and remove the subfolder on exit.
+	if (!staging_folder_path.empty())
+	{
+		staging_folder_path /= unique_path("igrow-%%%%-%%%%");
+		create_directory(staging_folder_path);
+		cout << "Staging docking input and output in " << staging_folder_path << endl;
+	}
+	const private_folder staging(staging_folder_path);
+
+	// Start the clocks of the compute budget.
+	budget compute(max_seconds, max_dockings, max_cpu_seconds, patience, tolerance);
+
+	// Start counting the allocations of the global allocator if telemetry is requested.
+	const bool monitoring = !telemetry_path.empty();
+	if (monitoring) memory_usage::enable();
+
 	// The number of ligands (i.e. population size) is equal to the number of elitists plus mutants plus children.
 	const size_t num_children = num_additions + num_subtractions + num_crossovers;
 	const size_t num_ligands = num_elitists + num_children;
 	const double num_elitists_inv = static_cast<double>(1) / num_elitists;
 
-	// Initialize a pointer vector to dynamically hold and destroy generated ligands.
-	ptr_vector<ligand> ligands;
-	ligands.resize(num_ligands);
+	// Initialize an io service pool and create worker threads for later use.
+	cout << "Creating an io service pool of " << num_threads << " worker thread" << (num_threads == 1 ? "" : "s") << endl;
+	io_service_pool io(num_threads);
+	safe_counter<size_t> cnt;
 
-	// Parse the initial generation csv to get initial elite ligands.
+	// Stream the initial generation csv, which need not be sorted, keeping the num_elitists ligands of the lowest free energy in a bounded max-heap.
+	// Ties are broken by row order, so a sorted csv yields its first num_elitists rows.
+	cout << "Selecting " << num_elitists << " initial elite ligands from " << initial_generation_csv_path << endl;
+	vector<initial_ligand> elites;
 	{
+		priority_queue<initial_ligand> heap;
 		boost::filesystem::ifstream ifs(initial_generation_csv_path);
 		string line;
 		line.reserve(80);
 		getline(ifs, line); // Ligand,pKd1,pKd2,pKd3,pKd4,pKd5,pKd6,pKd7,pKd8,pKd9
-		for (size_t i = 0; i < num_elitists; ++i)
+		size_t row = 0;
+		while (getline(ifs, line))
 		{
-			// Check if there are sufficient initial elite ligands.
-			if (!getline(ifs, line))
+			if (line.empty()) continue;
+			++row;
+
+			// Parse the free energy.
+			const size_t comma1 = line.find(',', 1);
+			const size_t comma2 = line.find(',', comma1 + 2);
+			double fe;
+			try
 			{
-				cerr << "Failed to construct initial generation because the initial generation csv " << initial_generation_csv_path << " contains less than " << num_elitists << " ligands." << endl;
+				fe = stod(line.substr(comma1 + 1, comma2 - comma1 - 1));
+			}
+			catch (const std::exception&)
+			{
+				cerr << "Failed to parse the free energy at row " << row << " of the initial generation csv " << initial_generation_csv_path << endl;
 				return 1;
 			}
 
-			// Parse the elite ligand.
-			const size_t comma1 = line.find(',', 1);
-			ligands.replace(i, new ligand(initial_generation_folder_path / (line.substr(0, comma1) + ".pdbqt")));
+			// Keep the ligand if the heap is not full or it is better than the worst kept one.
+			if (heap.size() < num_elitists)
+			{
+				heap.push(initial_ligand(fe, row, line.substr(0, comma1)));
+			}
+			else if (fe < heap.top().fe)
+			{
+				heap.pop();
+				heap.push(initial_ligand(fe, row, line.substr(0, comma1)));
+			}
+		}
 
-			// Parse the free energy and ligand efficiency.
-			const size_t comma2 = line.find(',', comma1 + 2);
-			ligands[i].fe = stod(line.substr(comma1 + 1, comma2 - comma1 - 1));
+		// Check if there are sufficient initial elite ligands.
+		if (heap.size() < num_elitists)
+		{
+			cerr << "Failed to construct initial generation because the initial generation csv " << initial_generation_csv_path << " contains less than " << num_elitists << " ligands." << endl;
+			return 1;
+		}
+
+		// Drain the heap into ascending order of free energy.
+		elites.resize(num_elitists);
+		for (size_t i = num_elitists; i > 0; heap.pop())
+		{
+			elites[--i] = heap.top();
+		}
+		cout << "Selected " << num_elitists << " of " << row << " ligands" << endl;
+	}
+
+	// Parse the selected initial elite ligands in parallel.
+	vector<ligand> initial(num_elitists);
+	{
+		mutex m;
+		string error;
+		cnt.init(num_elitists);
+		for (size_t i = 0; i < num_elitists; ++i)
+		{
+			io.post([&, i]()
+			{
+				try
+				{
+					initial[i] = ligand(initial_generation_folder_path / (elites[i].name + ".pdbqt"));
+					initial[i].id = ligand_id(0, i);
+					initial[i].fe = elites[i].fe;
+				}
+				catch (const std::exception& e)
+				{
+					lock_guard<mutex> guard(m);
+					error = e.what();
+				}
+				cnt.increment();
+			});
+		}
+		cnt.wait();
+		if (!error.empty())
+		{
+			cerr << error << endl;
+			return 1;
 		}
 	}
 
@@ -246,16 +624,15 @@ int main(int argc, char* argv[])
 	const size_t num_fragments = fragments.size();
 	cout << "Found " << num_fragments << " fragments" << endl;
 
-	// Initialize a Mersenne Twister random number generator.
+	// Initialize a sharded cache of parsed fragments.
+	fragment_cache fc(fragments, fragment_cache_capacity);
+
+	// Every random choice is drawn from a counter-based stream keyed by the seed, the generation, the child and the attempt.
 	cout << "Using random seed " << seed << endl;
-	mt19937_64 eng(seed);
 
 	// Initialize a ligand validator.
 	const validator v(max_rotatable_bonds, max_atoms, max_heavy_atoms, max_hb_donors, max_hb_acceptors, max_mw);
 
-	// Initialize the number of failures. The program will stop if num_failures reaches max_failures.
-	atomic<size_t> num_failures(0);
-
 	// Initialize ligand filenames.
 	vector<string> ligand_filenames;
 	ligand_filenames.reserve(num_ligands);
@@ -264,196 +641,454 @@ int main(int argc, char* argv[])
 		ligand_filenames.push_back(to_string(i) + ".pdbqt");
 	}
 
-	// Find the full path to idock executable.
-	const path idock_path = path(search_path("idock")).make_preferred();
-	cout << "Using idock executable at " << idock_path << endl;
+	// Find the full path to idock executable, unless docking is brokered.
+	const docker dock(broker_path.empty() ? path(boost::process::search_path("idock")).make_preferred() : path(), idock_config_path, seed, broker_path);
+	if (broker_path.empty())
+	{
+		cout << "Using idock executable at " << dock.idock_path << endl;
+	}
+	else
+	{
+		cout << "Submitting idock jobs to docking broker at " << broker_path << endl;
+	}
+	scheduler sched(dock, num_docking_jobs, max<size_t>(thread::hardware_concurrency(), 1), max_retries, straggler_factor);
+	vector<size_t> quarantined;
+	if (num_docking_jobs > 1) cout << "Splitting docking into " << num_docking_jobs << " concurrent idock jobs" << endl;
+
+	// Dock the fragments against the receptor once if fragment weighting is requested, reusing the free energies cached by earlier runs on the same receptor and idock configuration.
+	vector<double> fragment_weights;
+	if (fragment_temperature > 0)
+	{
+		cout << "Scoring fragments against receptor " << receptor_path << " with cache folder " << grid_cache_path << endl;
+		try
+		{
+			const fragment_scores fs(fragments, fc, receptor_path, idock_config_path, grid_cache_path, output_folder_path / "fragment_scores", sched);
+			cout << "Found " << fs.num_cached << " cached and docked " << fs.num_docked << " fragments, weighing them at a temperature of " << fragment_temperature << " kcal/mol" << endl;
+			fragment_weights = fs.weights(fragment_temperature);
+		}
+		catch (const std::exception& e)
+		{
+			cerr << e.what() << endl;
+			return 1;
+		}
+	}
 
-	// Initialize arguments to idock.
-	vector<string> idock_args(10);
-	idock_args[0] = "--input_folder";
-	idock_args[2] = "--output_folder";
-	idock_args[4] = "--log";
-	idock_args[6] = "--seed";
-	idock_args[7] = to_string(seed);
-	idock_args[8] = "--config";
-	idock_args[9] = idock_config_path.string();
+	// Index the mutable atoms of the fragments, so that addition only samples fragments that fit the remaining budget of a parent ligand, by their weights if any.
+	cout << "Indexing fragments by their contribution to chemical properties" << endl;
+	const fragment_index fi(fc, v, fragment_weights);
+	cout << "Indexed " << fi.size() << " mutable atoms of fragments" << endl;
 
-	// Initialize an io service pool and create worker threads for later use.
-	cout << "Creating an io service pool of " << num_threads << " worker thread" << (num_threads == 1 ? "" : "s") << endl;
-	io_service_pool io(num_threads);
-	safe_counter<size_t> cnt;
+	// Derive a reduced-effort idock configuration for screening if requested, overriding the number of Monte Carlo tasks and keeping one conformation, and schedule it separately so that the runtime models of both efforts are learned apart.
+	const bool screening = num_screen_tasks > 0;
+	const path screen_config_path = output_folder_path / "idock_screen.cfg";
+	if (screening)
+	{
+		boost::filesystem::ifstream ifs(idock_config_path);
+		boost::filesystem::ofstream ofs(screen_config_path);
+		for (string line; getline(ifs, line);)
+		{
+			string key = line.substr(0, line.find('='));
+			key.erase(remove_if(key.begin(), key.end(), ::isspace), key.end());
+			if (key == "tasks" || key == "max_conformations") continue;
+			ofs << line << '\n';
+		}
+		ofs << "tasks = " << num_screen_tasks << '\n'
+			<< "max_conformations = 1\n";
+		cout << "Screening children with " << num_screen_tasks << " Monte Carlo tasks using idock configuration " << screen_config_path << endl;
+	}
+	const docker screen_dock(dock.idock_path, screen_config_path, seed, broker_path);
+	scheduler screen_sched(screen_dock, num_docking_jobs, max<size_t>(thread::hardware_concurrency(), 1), max_retries, straggler_factor);
+	vector<const ligand*> children(num_children);
+
+	// Map the surrogate scoring grid of the receptor if pre-screening or warm starting is requested.
+	unique_ptr<surrogate> sg;
+	if (num_candidates > 1 || warm_starting)
+	{
+		cout << "Mapping surrogate scoring grid of receptor " << receptor_path << " from cache folder " << grid_cache_path << endl;
+		sg.reset(new surrogate(receptor_path, box(center, span, granularity), grid_cache_path, io));
+	}
+
+	// Initialize the local optimizer if warm starting is requested.
+	unique_ptr<optimizer> opt;
+	if (warm_starting) opt.reset(new optimizer(*sg));
+
+	// Hash the receptor for geometric prefiltering if requested.
+	unique_ptr<prefilter> pf;
+	if (prefiltering)
+	{
+		cout << "Hashing receptor " << receptor_path << " for geometric prefiltering" << endl;
+		pf.reset(new prefilter(receptor_path, box(center, span, granularity), max_overlap));
+	}
+
+	// Initialize the generation loop with the optional stages of creating a child, and select the initial elites. The children are docked by the loop below between the stages of the grower.
+	grower::options stages;
+	stages.num_candidates = num_candidates;
+	stages.sg = sg.get();
+	stages.opt = opt.get();
+	stages.pf = pf.get();
+	stages.tabu_searching = tabu_searching;
+	stages.max_similarity = max_similarity;
+	stages.large_population = large_population;
+	grower g(fc, fi, v, grower::scorer(), num_elitists, num_additions, num_subtractions, num_crossovers, max_failures, seed, io, stages);
+	g.initialize(std::move(initial));
 
 	// Initialize log file for dumping statistics.
 	boost::filesystem::ofstream log(log_path);
 	log << "generation,ligand,parent 1,connector 1,parent 2,connector 2,free energy (kcal/mol),rotatable bonds,atoms,heavy atoms,hydrogen bond donors,hydrogen bond acceptors,molecular weight (g/mol)\n";
 
+	// Resolve the identities of ligands to the paths they are parsed from or saved to only when writing the log and the lineage store. Children are saved into the input subfolder of their generation folder, unless the input subfolder is staged, or into entries of the archive of their generation, e.g. 3.pdbqt.gz:7.pdbqt, which igrow-extract accepts.
+	vector<path> initial_paths;
+	initial_paths.reserve(num_elitists);
+	for (size_t i = 0; i < num_elitists; ++i)
+	{
+		initial_paths.push_back(initial_generation_folder_path / (elites[i].name + ".pdbqt"));
+	}
+	const string archive_extension(archiving ? (compressing ? ".pdbqt.gz" : ".pdbqt") : "");
+	const path_resolver resolve(output_folder_path, staging_folder_path.empty() && !archiving ? path("input") : path(), initial_paths, fragments, archive_extension);
+
+	// Initialize a lineage store alongside the log file for tracing the ancestry of ligands by igrow-lineage, recording the initial elites first so that children never precede their parents.
+	lineage_writer lineage(path(log_path).replace_extension(".lineage"), resolve);
+	for (size_t i = 0; i < num_elitists; ++i)
+	{
+		lineage.write(1, g[i]);
+	}
+
+	// Initialize telemetry file for dumping memory usage per phase if requested.
+	boost::filesystem::ofstream telemetry;
+	if (monitoring)
+	{
+		telemetry.open(telemetry_path);
+		telemetry << "generation,phase,allocations,deallocations,allocated bytes,live bytes,peak live bytes,resident set size,peak resident set size,resident fragments,resident fragment bytes\n";
+	}
+	memory_usage phase_start = memory_usage::now(), generation_start = phase_start;
+
+	// Dump the memory usage of a phase, i.e. the allocations since the previous phase, the live bytes at its end and their peak during it.
+	const auto record = [&](const size_t generation, const char* phase)
+	{
+		if (!monitoring) return;
+		const memory_usage m = memory_usage::now();
+		telemetry << generation
+			<< ',' << phase
+			<< ',' << m.allocations - phase_start.allocations
+			<< ',' << m.deallocations - phase_start.deallocations
+			<< ',' << m.allocated_bytes - phase_start.allocated_bytes
+			<< ',' << m.live_bytes
+			<< ',' << m.peak_live_bytes
+			<< ',' << m.rss
+			<< ',' << m.peak_rss
+			<< ',' << fc.resident()
+			<< ',' << fc.resident_bytes()
+			<< endl;
+		phase_start = m;
+		memory_usage::reset_peak();
+	};
+
 	cout.setf(ios::fixed, ios::floatfield);
 	cout << setprecision(3);
 	for (size_t generation = 1; true; ++generation)
 	{
 		cout << "Running generation " << generation << endl;
+		generation_start = phase_start;
 
-		// Initialize the paths to current generation folder and its two subfolders.
+		// Initialize the paths to current generation folder and its two docking subfolders, which are placed in the staging folder if requested.
 		const path generation_folder(output_folder_path / to_string(generation));
-		const path  input_folder(generation_folder /  "input");
-		const path output_folder(generation_folder / "output");
+		const path docking_folder(staging_folder_path.empty() ? generation_folder : staging_folder_path / to_string(generation));
+		const path  input_folder(docking_folder /  "input");
+		const path output_folder(docking_folder / "output");
+
+		// Child ligands are saved into the input subfolder for docking. Their docked poses are finally saved into the ligand folder, or into the archive of current generation if archiving is requested.
+		const path ligand_folder(staging_folder_path.empty() && !archiving ? input_folder : generation_folder);
+		const path generation_log_path(archiving ? output_folder_path / (to_string(generation) + ".csv") : generation_folder / default_log_path);
 
 		// Create a new folder and two subfolders for current generation.
-		create_directory(generation_folder);
+		if (!archiving || staging_folder_path.empty()) create_directory(generation_folder);
+		create_directory(docking_folder);
 		create_directory( input_folder);
 		create_directory(output_folder);
 
-		// Create addition, subtraction and crossover tasks.
-		cnt.init(num_children);
-		for (size_t i = 0; i < num_additions; ++i)
+		// Create the children from the elites, saving every kept child into the input subfolder for docking, and shedding its structure in large-population mode until it is docked.
+		const bool bred = g.breed([&](const size_t i, ligand& l)
 		{
-			const size_t s = eng();
-			io.post([&, i, s]()
-			{
-				const size_t index = num_elitists + i;
+			l.save(input_folder / ligand_filenames[i]);
+			if (large_population) l.shed();
+		});
 
-				// Initialize a Mersenne Twister random number generator.
-				mt19937_64 eng(s);
-				uniform_int_distribution<size_t> uniform_elitist(0, num_elitists - 1);
-				uniform_int_distribution<size_t> uniform_fragment(0, num_fragments - 1);
+		if (g.tabu_hits()) cout << "Skipped " << g.tabu_hits() << " operations known to be infeasible, memorizing " << g.tabu_size() << " in total" << endl;
 
-				// Create a child ligand by addition.
-				do
-				{
-					// Obtain references to the two parent ligands.
-					ligand& l1 = ligands[uniform_elitist(eng)];
-					ligand l2 = ligand_flyweight(fragments[uniform_fragment(eng)]);
-					while (!(l1.addition_feasible() && l2.addition_feasible()))
-					{
-						l1 = ligands[uniform_elitist(eng)];
-						l2 = ligand_flyweight(fragments[uniform_fragment(eng)]);
-					}
+		// Check if the maximum number of failures has been reached.
+		if (!bred)
+		{
+			cout << "The number of failures has reached " << max_failures << endl;
+			if (archiving) remove_all(docking_folder);
+			return 0;
+		}
 
-					// Obtain a random mutable atom from the two parent ligands respectively.
-					const size_t g1 = uniform_int_distribution<size_t>(0, l1.mutable_atoms.size() - 1)(eng);
-					const size_t g2 = uniform_int_distribution<size_t>(0, l2.mutable_atoms.size() - 1)(eng);
+		// Skip docking children that are near-duplicates of earlier kept siblings, leaving them undocked so that they are never selected as elites.
+		if (g.num_duplicates())
+		{
+			for (size_t i = 0; i < num_children; ++i)
+			{
+				if (g.duplicate(i)) remove(input_folder / ligand_filenames[i]);
+			}
+			cout << "Skipped docking " << g.num_duplicates() << " near-duplicate children" << endl;
+		}
 
-					ligands.replace(index, new ligand(input_folder / ligand_filenames[i], l1, l2, g1, g2));
-					if (v(ligands[index]))
-					{
-						// Save the newly created child ligand.
-						ligands[index].save();
-						break;
-					}
-				} while (++num_failures < max_failures);
-				cnt.increment();
-			});
+		// Let the refined free energy of a warm-started child stand in for docking unless it is within the margin of the worst elite, writing the child in place of its docked pose.
+		if (warm_starting)
+		{
+			double worst_elite_fe = g[0].fe;
+			for (size_t i = 1; i < num_elitists; ++i)
+			{
+				worst_elite_fe = max(worst_elite_fe, g[i].fe);
+			}
+			size_t num_stand_ins = 0;
+			for (size_t i = 0; i < num_additions; ++i)
+			{
+				const path input_path = input_folder / ligand_filenames[i];
+				const double wfe = g.warm_fe(i);
+				if (wfe < worst_elite_fe + dock_margin || !exists(input_path)) continue;
+				const ligand& l = g[num_elitists + i];
+				const double e_inter = wfe / scoring_function::normalize(1, l.num_rotatable_bonds);
+				boost::filesystem::ofstream ofs(output_folder / ligand_filenames[i]);
+				ofs.setf(ios::fixed, ios::floatfield);
+				ofs << setprecision(3)
+					<< "MODEL        1\n"
+					<< "REMARK       NORMALIZED FREE ENERGY PREDICTED BY IGROW:" << setw(8) << wfe << " KCAL/MOL\n"
+					<< "REMARK            TOTAL FREE ENERGY PREDICTED BY IGROW:" << setw(8) << e_inter << " KCAL/MOL\n"
+					<< "REMARK     INTER-LIGAND FREE ENERGY PREDICTED BY IGROW:" << setw(8) << e_inter << " KCAL/MOL\n"
+					<< "REMARK     INTRA-LIGAND FREE ENERGY PREDICTED BY IGROW:" << setw(8) << 0.0 << " KCAL/MOL\n"
+					<< "REMARK            LIGAND EFFICIENCY PREDICTED BY IGROW:" << setw(8) << wfe / l.num_heavy_atoms << " KCAL/MOL\n";
+				{
+					boost::filesystem::ifstream ifs(input_path);
+					ofs << ifs.rdbuf();
+				}
+				ofs << "ENDMDL\n";
+				ofs.close();
+				remove(input_path);
+				++num_stand_ins;
+			}
+			if (num_stand_ins) cout << "Skipped docking " << num_stand_ins << " warm-started children whose refined free energy stands in" << endl;
+		}
+
+		// Dock the children in priority order as far as the remaining budget affords, leaving the others undocked with free energy 0, so that a generation cut short keeps its best partial result.
+		vector<pair<double, size_t>> pending;
+		for (size_t i = 0; i < num_children; ++i)
+		{
+			if (exists(input_folder / ligand_filenames[i])) pending.push_back(make_pair(g.priority(i), i));
 		}
-		for (size_t i = num_additions; i < num_additions + num_subtractions; ++i)
+		const size_t num_affordable = compute.affordable(pending.size());
+		if (num_affordable < pending.size())
 		{
-			const size_t s = eng();
-			io.post([&, i, s]()
+			stable_sort(pending.begin(), pending.end());
+			for (size_t k = num_affordable; k < pending.size(); ++k)
 			{
-				const size_t index = num_elitists + i;
+				remove(input_folder / ligand_filenames[pending[k].second]);
+			}
+			cout << "Docking " << num_affordable << " of " << pending.size() << " children in priority order within the remaining budget" << endl;
+			pending.resize(num_affordable);
+		}
 
-				// Initialize a Mersenne Twister random number generator.
-				mt19937_64 eng(s);
-				uniform_int_distribution<size_t> uniform_elitist(0, num_elitists - 1);
+		// Invoke idock.
+		record(generation, "creation");
+		for (size_t i = 0; i < num_children; ++i)
+		{
+			children[i] = &g[num_elitists + i];
+		}
+		if (screening)
+		{
+			// Screen every child at reduced effort, logging into a separate csv.
+			compute.start();
+			const auto exit_code = screen_sched(input_folder, output_folder, path(generation_log_path).replace_extension(".screen.csv"), ligand_filenames, children, quarantined, compute.deadline());
+			compute.charge(pending.size());
+			if (exit_code)
+			{
+				cerr << "idock exited with code " << exit_code << endl;
+				return 1;
+			}
 
-				// Create a child ligand by subtraction.
-				do
-				{
-					// Obtain reference to the parent ligand.
-					ligand& l1 = ligands[uniform_elitist(eng)];
-					while (!l1.subtraction_feasible())
-					{
-						l1 = ligands[uniform_elitist(eng)];
-					}
+			// Select the top fraction of the screened children and those within the margin of the worst elite, and move them into a folder of their own for re-docking. Their screened poses are moved aside, so that a failed re-docking job cannot leave a screened pose to pass for a complete one.
+			vector<pair<double, size_t>> screened;
+			for (size_t i = 0; i < num_children; ++i)
+			{
+				if (exists(input_folder / ligand_filenames[i]) && exists(output_folder / ligand_filenames[i])) screened.push_back(make_pair(ligand::docked_fe(output_folder / ligand_filenames[i]), i));
+			}
+			stable_sort(screened.begin(), screened.end());
+			double worst_elite_fe = g[0].fe;
+			for (size_t i = 1; i < num_elitists; ++i)
+			{
+				worst_elite_fe = max(worst_elite_fe, g[i].fe);
+			}
+			const size_t num_top = static_cast<size_t>(ceil(redock_fraction * screened.size()));
+			const size_t max_redocked = compute.affordable(screened.size());
+			const path redock_folder(docking_folder / "redock");
+			const path screened_folder(docking_folder / "screened");
+			create_directory(redock_folder);
+			create_directory(screened_folder);
+			vector<size_t> redocked;
+			for (size_t k = 0; k < max_redocked; ++k)
+			{
+				if (k >= num_top && screened[k].first >= worst_elite_fe + redock_margin) break;
+				const size_t i = screened[k].second;
+				rename(input_folder / ligand_filenames[i], redock_folder / ligand_filenames[i]);
+				rename(output_folder / ligand_filenames[i], screened_folder / ligand_filenames[i]);
+				redocked.push_back(i);
+			}
+			cout << "Re-docking " << redocked.size() << " of " << screened.size() << " screened children at full effort" << endl;
 
-					// Obtain a random mutable atom from the two parent ligands respectively.
-					const size_t g1 = uniform_int_distribution<size_t>(1, l1.num_rotatable_bonds)(eng);
+			// Re-dock the selected children at full effort and move them back. A child quarantined by either stage is left as quarantined, and one quarantined by re-docking falls back to its screened pose.
+			vector<size_t> requarantined;
+			compute.start();
+			const auto redock_exit_code = sched(redock_folder, output_folder, generation_log_path, ligand_filenames, children, requarantined, compute.deadline());
+			compute.charge(redocked.size());
+			for (const size_t i : redocked)
+			{
+				rename(redock_folder / ligand_filenames[i], input_folder / ligand_filenames[i]);
+			}
+			for (const size_t i : requarantined)
+			{
+				rename(screened_folder / ligand_filenames[i], output_folder / ligand_filenames[i]);
+			}
+			remove(redock_folder);
+			remove_all(screened_folder);
+			if (redock_exit_code)
+			{
+				cerr << "idock exited with code " << redock_exit_code << endl;
+				return 1;
+			}
+			quarantined.insert(quarantined.end(), requarantined.cbegin(), requarantined.cend());
+			sort(quarantined.begin(), quarantined.end());
+		}
+		else
+		{
+			compute.start();
+			const auto exit_code = sched(input_folder, output_folder, generation_log_path, ligand_filenames, children, quarantined, compute.deadline());
+			compute.charge(pending.size());
+			if (exit_code)
+			{
+				cerr << "idock exited with code " << exit_code << endl;
+				return 1;
+			}
+		}
+		record(generation, "docking");
 
-					ligands.replace(index, new ligand(input_folder / ligand_filenames[i], l1, g1));
-					if (v(ligands[index]))
-					{
-						// Save the newly created child ligand.
-						ligands[index].save();
-						break;
-					}
-				} while (++num_failures < max_failures);
-				cnt.increment();
-			});
+		// Keep a copy of the quarantined ligands for inspection. Their free energy is left 0 as they are not docked.
+		if (!quarantined.empty())
+		{
+			const path quarantine_folder(output_folder_path / "quarantine");
+			create_directories(quarantine_folder);
+			for (const size_t i : quarantined)
+			{
+				copy_file(input_folder / ligand_filenames[i], quarantine_folder / (to_string(generation) + "-" + ligand_filenames[i]), copy_option::overwrite_if_exists);
+			}
 		}
-		for (size_t i = num_additions + num_subtractions; i < num_children; ++i)
+
+		// Copy the output of idock for a docked child as is, i.e. all its conformations, or serialize an undocked child as saved for docking, into an entry of the archive of current generation.
+		const auto pack = [&](const ligand& l, const size_t i)
 		{
-			const size_t s = eng();
-			io.post([&, i, s]()
+			ostringstream oss;
+			if (l.docked)
 			{
-				const size_t index = num_elitists + i;
+				boost::filesystem::ifstream ifs(output_folder / ligand_filenames[i], ios::binary);
+				oss << ifs.rdbuf();
+			}
+			else
+			{
+				l.save(oss);
+			}
+			return oss.str();
+		};
+		unique_ptr<archive_writer> w;
+		if (archiving) w.reset(new archive_writer(output_folder_path / (to_string(generation) + archive_extension), compressing));
 
-				// Initialize a Mersenne Twister random number generator.
-				mt19937_64 eng(s);
-				uniform_int_distribution<size_t> uniform_elitist(0, num_elitists - 1);
+		if (!large_population)
+		{
+			// Parse docked ligands to obtain predicted free energy and docked coordinates, and save the updated ligands into the ligand subfolder or the archive.
+			for (size_t i = 0; i < num_children; ++i)
+			{
+				ligand& l = g[num_elitists + i];
+				l.update(output_folder / ligand_filenames[i]);
+				if (archiving) w->write(ligand_filenames[i], pack(l, i));
+				else l.save(ligand_folder / ligand_filenames[i]);
+			}
 
-				// Create a child ligand by crossover.
-				do
+			// Sort ligands in ascending order of efficacy.
+			g.select();
+		}
+		else
+		{
+			// Parse only the predicted free energy of the docked children.
+			cnt.init(num_children);
+			for (size_t i = 0; i < num_children; ++i)
+			{
+				io.post([&, i]()
 				{
-					// Obtain constant references to the two parent ligands.
-					ligand& l1 = ligands[uniform_elitist(eng)];
-					ligand& l2 = ligands[uniform_elitist(eng)];
-					while (!(l1.crossover_feasible() && l2.crossover_feasible()))
-					{
-						l1 = ligands[uniform_elitist(eng)];
-						l2 = ligands[uniform_elitist(eng)];
-					}
+					ligand& l = g[num_elitists + i];
+					l.fe = ligand::docked_fe(output_folder / ligand_filenames[i]);
+					l.docked = exists(output_folder / ligand_filenames[i]);
+					cnt.increment();
+				});
+			}
+			cnt.wait();
 
-					// Obtain a random mutable atom from the two parent ligands respectively.
-					const size_t g1 = uniform_int_distribution<size_t>(1, l1.num_rotatable_bonds)(eng);
-					const size_t g2 = uniform_int_distribution<size_t>(1, l2.num_rotatable_bonds)(eng);
+			// Select the elites by partially sorting a compact array of free energies and population indexes, ranking undocked children last.
+			const vector<bool>& elite = g.rank();
 
-					ligands.replace(index, new ligand(input_folder / ligand_filenames[i], l1, l2, g1, g2, true));
-					if (v(ligands[index]))
+			// Rehydrate, update and save the docked children chunk by chunk, keeping the structures of the elites only.
+			const size_t chunk_size = 4096;
+			vector<string> entries(archiving ? min(chunk_size, num_children) : 0);
+			for (size_t chunk = 0; chunk < num_children; chunk += chunk_size)
+			{
+				const size_t chunk_end = min(chunk + chunk_size, num_children);
+				cnt.init(chunk_end - chunk);
+				for (size_t i = chunk; i < chunk_end; ++i)
+				{
+					io.post([&, i, chunk]()
+					{
+						ligand& l = g[num_elitists + i];
+						const path input_path = input_folder / ligand_filenames[i];
+						const path docked_path = output_folder / ligand_filenames[i];
+						if (exists(input_path) || exists(docked_path))
+						{
+							l.rehydrate(exists(input_path) ? input_path : docked_path); // The input of a warm-started child standing in for docking has been moved into its docked pose.
+							l.update(docked_path);
+							if (archiving) entries[i - chunk] = pack(l, i);
+							else l.save(ligand_folder / ligand_filenames[i]);
+							if (!elite[num_elitists + i]) l.shed();
+						}
+						cnt.increment();
+					});
+				}
+				cnt.wait();
+				if (archiving)
+				{
+					for (size_t i = chunk; i < chunk_end; ++i)
 					{
-						// Save the newly created child ligand.
-						ligands[index].save();
-						break;
+						if (entries[i - chunk].empty()) continue;
+						w->write(ligand_filenames[i], entries[i - chunk]);
+						entries[i - chunk].clear();
 					}
-				} while (++num_failures < max_failures);
-				cnt.increment();
-			});
-		}
-		cnt.wait();
-
-		// Check if the maximum number of failures has been reached.
-		if (num_failures >= max_failures)
-		{
-			cout << "The number of failures has reached " << max_failures << endl;
-			return 0;
-		}
+				}
+			}
 
-		// Invoke idock.
-		idock_args[1] =  input_folder.string();
-		idock_args[3] = output_folder.string();
-		idock_args[5] = (generation_folder / default_log_path).string();
-		const auto exit_code = wait_for_exit(execute(run_exe(idock_path), set_args(idock_args), throw_on_error()));
-		if (exit_code)
-		{
-			cerr << "idock exited with code " << exit_code << endl;
-			return 1;
+			// Shed the previous elites that are no longer elite, and reorder the population so that the elites come first.
+			g.select();
 		}
+		if (archiving) w->close();
 
-		// Parse docked ligands to obtain predicted free energy and docked coordinates, and save the updated ligands into the ligand subfolder.
-		for (size_t i = 0; i < num_children; ++i)
-		{
-			ligands[num_elitists + i].update(output_folder / ligand_filenames[i]);
-		}
+		// Remove the docking input and output unless they are kept as the ligand folder.
+		if (archiving || !staging_folder_path.empty()) remove_all(docking_folder);
 
-		// Sort ligands in ascending order of efficacy.
-		ligands.sort();
+		record(generation, "update");
 
 		// Write summaries to csv and calculate average statistics.
-		for (const auto& l : ligands)
+		for (size_t i = 0; i < num_ligands; ++i)
 		{
+			const ligand& l = g[i];
 			log << generation
-				<< ',' << l.p
-				<< ',' << l.parent1
+				<< ',' << resolve(l.id)
+				<< ',' << resolve(l.parent1)
 				<< ',' << l.connector1
-				<< ',' << l.parent2
+				<< ',' << resolve(l.parent2)
 				<< ',' << l.connector2
 				<< ',' << l.fe
 				<< ',' << l.num_rotatable_bonds
@@ -463,13 +1098,15 @@ int main(int argc, char* argv[])
 				<< ',' << l.num_hb_acceptors
 				<< ',' << l.mw
 				<< endl;
+			lineage.write(generation, l);
 		}
+		lineage.flush();
 
 		// Calculate average statistics of elite ligands.
 		double avg_mw = 0, avg_fe = 0, avg_le = 0, avg_rotatable_bonds = 0, avg_atoms = 0, avg_heavy_atoms = 0, avg_hb_donors = 0, avg_hb_acceptors = 0;
 		for (size_t i = 0; i < num_elitists; ++i)
 		{
-			const ligand& l = ligands[i];
+			const ligand& l = g[i];
 			avg_mw += l.mw;
 			avg_fe += l.fe;
 			avg_rotatable_bonds += l.num_rotatable_bonds;
@@ -486,12 +1123,33 @@ int main(int argc, char* argv[])
 		avg_hb_donors *= num_elitists_inv;
 		avg_hb_acceptors *= num_elitists_inv;
 		cout << "Failures |  Avg FE |  Avg HA | Avg MWT | Avg NRB | Avg HBD | Avg HBA\n"
-		    << setw(8) << num_failures << "   "
+		    << setw(8) << g.failures() << "   "
 			<< setw(7) << avg_fe << "   "
 			<< setw(7) << avg_heavy_atoms << "   "
 			<< setw(7) << avg_mw << "   "
 			<< setw(7) << avg_rotatable_bonds << "   "
 			<< setw(7) << avg_hb_donors << "   "
 			<< setw(7) << avg_hb_acceptors << endl;
+		if (monitoring)
+		{
+			const double mb = 1.0 / (1 << 20);
+			cout << "RSS (MB) | Peak MB | Live MB |  Allocs |   Frags | Frag MB\n"
+				<< setw(8) << phase_start.rss * mb << "   "
+				<< setw(7) << phase_start.peak_rss * mb << "   "
+				<< setw(7) << phase_start.live_bytes * mb << "   "
+				<< setw(7) << phase_start.allocations - generation_start.allocations << "   "
+				<< setw(7) << fc.resident() << "   "
+				<< setw(7) << fc.resident_bytes() * mb << endl;
+		}
+
+		// Check if the budget has been exhausted or the elites have converged.
+		compute.complete(avg_fe);
+		const string exhausted = compute.exhausted();
+		if (!exhausted.empty() || compute.converged())
+		{
+			if (exhausted.empty()) cout << "The average free energy of elites has not improved by " << tolerance << " kcal/mol for " << patience << " generations" << endl;
+			else cout << "The " << exhausted << " has been exhausted" << endl;
+			return 0;
+		}
 	}
 }
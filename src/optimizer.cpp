@@ -0,0 +1,208 @@
+#include "array.hpp"
+#include "transform.hpp"
+#include "scoring_function.hpp"
+#include "optimizer.hpp"
+
+const double optimizer::max_translation = 1.0;
+const double optimizer::max_rotation = 0.35;
+const size_t optimizer::max_evaluations = 400;
+
+//! Returns the rotation matrix of a signed angle about a normalized axis.
+static array<double, 9> rotation(const array<double, 3>& a, const double angle)
+{
+	return vec3_to_mat3(sin(angle) < 0 ? -1 * a : a, cos(angle));
+}
+
+double optimizer::operator()(ligand& l, const size_t max_core_srn) const
+{
+	// Find the frame of the new rotatable bond, which connects an atom of the core to an atom of the fragment.
+	size_t k = 1;
+	while (k < l.frames.size() && !(l.frames[k].rotorX <= max_core_srn && l.frames[k].rotorY > max_core_srn)) ++k;
+	if (k == l.frames.size()) return sg.score(l);
+
+	// Mark the atoms of the subtree rooted at the frame, which rotate with the new bond.
+	vector<bool> moving(l.num_atoms);
+	vector<size_t> stack(1, k);
+	while (!stack.empty())
+	{
+		const size_t b = stack.back();
+		const frame& f = l.frames[b];
+		stack.pop_back();
+		for (size_t i = f.begin; i < f.end; ++i)
+		{
+			moving[i] = true;
+		}
+		stack.insert(stack.end(), l.branch_frames.cbegin() + l.branch_offsets[b], l.branch_frames.cbegin() + l.branch_offsets[b + 1]);
+	}
+
+	// Locate the two atoms of the new bond, whose direction is the torsion axis.
+	size_t x = 0, y = 0;
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		if (l.atoms[i].srn == l.frames[k].rotorX) x = i;
+		if (l.atoms[i].srn == l.frames[k].rotorY) y = i;
+	}
+	const array<double, 3> pivot = l.atoms[x].coordinate;
+	const array<double, 3> axis = normalize(l.atoms[y].coordinate - pivot);
+
+	// Split the heavy atoms into a moving and a fixed block of coordinates, and rotate the ligand about the centroid of its heavy atoms.
+	const vector<size_t> types = surrogate::xs(l);
+	vector<size_t> mi, fi;
+	array<double, 3> center = { 0, 0, 0 };
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		if (types[i] == scoring_function::n) continue;
+		(moving[i] ? mi : fi).push_back(i);
+		center = center + l.atoms[i].coordinate;
+	}
+	center = (1.0 / (mi.size() + fi.size())) * center;
+	soa_coordinates m0(mi.size()), m1(mi.size()), m2(mi.size()), f0(fi.size()), f2(fi.size());
+	for (size_t j = 0; j < mi.size(); ++j)
+	{
+		m0.set(j, l.atoms[mi[j]].coordinate);
+	}
+	for (size_t j = 0; j < fi.size(); ++j)
+	{
+		f0.set(j, l.atoms[fi[j]].coordinate);
+	}
+
+	// Find the pairs of moving and fixed heavy atoms separated by more than 3 bonds, the only intramolecular pairs whose distances change with the torsion.
+	vector<size_t> heavy(mi);
+	heavy.insert(heavy.end(), fi.cbegin(), fi.cend());
+	vector<vector<size_t>> neighbors(heavy.size());
+	for (size_t a = 0; a < heavy.size(); ++a)
+	{
+		for (size_t b = a + 1; b < heavy.size(); ++b)
+		{
+			if (!l.atoms[heavy[a]].is_neighbor(l.atoms[heavy[b]])) continue;
+			neighbors[a].push_back(b);
+			neighbors[b].push_back(a);
+		}
+	}
+	vector<array<size_t, 2>> pairs;
+	vector<size_t> depth(heavy.size());
+	for (size_t a = 0; a < mi.size(); ++a)
+	{
+		fill(depth.begin(), depth.end(), 4);
+		depth[a] = 0;
+		vector<size_t> queue(1, a);
+		for (size_t q = 0; q < queue.size(); ++q)
+		{
+			const size_t c = queue[q];
+			if (depth[c] == 3) continue;
+			for (const size_t b : neighbors[c])
+			{
+				if (depth[b] <= depth[c] + 1) continue;
+				depth[b] = depth[c] + 1;
+				queue.push_back(b);
+			}
+		}
+		for (size_t b = mi.size(); b < heavy.size(); ++b)
+		{
+			if (depth[b] > 3) pairs.push_back({ a, b - mi.size() });
+		}
+	}
+
+	// Evaluate the inter- and intramolecular energy of a pose given by the torsion angle, the translation and the rotation vector.
+	typedef array<double, 7> conformation;
+	const auto evaluate = [&](const conformation& c)
+	{
+		transform(m0, m1, rotation(axis, c[0]), pivot, pivot);
+		const array<double, 3> w = { c[4], c[5], c[6] };
+		const double angle = norm(w);
+		const array<double, 9> r = angle > 0 ? rotation((1 / angle) * w, angle) : vec3_to_mat3(w, 1);
+		const array<double, 3> t = { center[0] + c[1], center[1] + c[2], center[2] + c[3] };
+		transform(m1, m2, r, center, t);
+		transform(f0, f2, r, center, t);
+		double e_inter = 0;
+		for (size_t j = 0; j < mi.size(); ++j)
+		{
+			e_inter += sg.e(types[mi[j]], m2.get(j));
+		}
+		for (size_t j = 0; j < fi.size(); ++j)
+		{
+			e_inter += sg.e(types[fi[j]], f2.get(j));
+		}
+		double e_intra = 0;
+		for (const auto& p : pairs)
+		{
+			const double r2 = distance_sqr(m2.get(p[0]), f2.get(p[1]));
+			if (r2 < scoring_function::cutoff_sqr) e_intra += scoring_function::e(types[mi[p[0]]], types[fi[p[1]]], sqrt(r2));
+		}
+		return e_inter + e_intra;
+	};
+	const auto feasible = [](const conformation& c)
+	{
+		return sqr(c[1]) + sqr(c[2]) + sqr(c[3]) <= sqr(max_translation) && sqr(c[4]) + sqr(c[5]) + sqr(c[6]) <= sqr(max_rotation);
+	};
+
+	// Scan the torsion coarsely, as the new bond is placed at an arbitrary torsion angle by addition.
+	const double pi = 3.14159265358979323846;
+	conformation best = {};
+	double e_best = evaluate(best);
+	size_t num_evaluations = 1;
+	for (size_t s = 1; s < 12; ++s, ++num_evaluations)
+	{
+		conformation c = {};
+		c[0] = s * pi / 6;
+		const double e = evaluate(c);
+		if (e < e_best)
+		{
+			best = c;
+			e_best = e;
+		}
+	}
+
+	// Refine all the degrees of freedom by compass search, halving the steps whenever no move along any of them improves the energy.
+	conformation step = { pi / 12, 0.5, 0.5, 0.5, 0.1, 0.1, 0.1 };
+	for (size_t num_halvings = 0; num_halvings < 5 && num_evaluations < max_evaluations;)
+	{
+		bool improved = false;
+		for (size_t d = 0; d < step.size() && num_evaluations < max_evaluations; ++d)
+		{
+			for (const double sign : { 1.0, -1.0 })
+			{
+				conformation c = best;
+				c[d] += sign * step[d];
+				if (!feasible(c)) continue;
+				const double e = evaluate(c);
+				++num_evaluations;
+				if (e < e_best)
+				{
+					best = c;
+					e_best = e;
+					improved = true;
+					break;
+				}
+			}
+		}
+		if (improved) continue;
+		for (auto& s : step)
+		{
+			s *= 0.5;
+		}
+		++num_halvings;
+	}
+
+	// Apply the best pose to all the atoms, including hydrogens.
+	soa_coordinates a0(l.num_atoms), a1(l.num_atoms);
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		a0.set(i, l.atoms[i].coordinate);
+	}
+	transform(a0, a1, rotation(axis, best[0]), pivot, pivot);
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		if (!moving[i]) a1.set(i, a0.get(i));
+	}
+	const array<double, 3> w = { best[4], best[5], best[6] };
+	const double angle = norm(w);
+	transform(a1, a0, angle > 0 ? rotation((1 / angle) * w, angle) : vec3_to_mat3(w, 1), center, { center[0] + best[1], center[1] + best[2], center[2] + best[3] });
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		l.atoms[i].coordinate = a0.get(i);
+	}
+
+	// Score the refined pose afresh, as the X-Score atom types are perceived from the bonds of the new pose.
+	return sg.score(l);
+}
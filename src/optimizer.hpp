@@ -0,0 +1,26 @@
+#pragma once
+#ifndef IGROW_OPTIMIZER_HPP
+#define IGROW_OPTIMIZER_HPP
+
+#include "surrogate.hpp"
+
+//! Represents an in-process local optimizer, which warm-starts the pose of a child created by addition from the docked pose of its parent.
+//! Only the torsion of the new rotatable bond and a small rigid-body adjustment of the whole ligand are optimized against the grid maps of the surrogate.
+class optimizer
+{
+public:
+	static const double max_translation; //!< Maximum norm of the rigid-body translation.
+	static const double max_rotation; //!< Maximum angle of the rigid-body rotation.
+	static const size_t max_evaluations; //!< Maximum number of energy evaluations per ligand.
+
+	//! Constructs an optimizer against the grid maps of a surrogate.
+	explicit optimizer(const surrogate& sg) : sg(sg) {}
+
+	//! Refines in place the pose of a ligand whose atoms of serial numbers up to max_core_srn form the docked core, and returns its predicted free energy in the refined pose.
+	double operator()(ligand& l, const size_t max_core_srn) const;
+
+private:
+	const surrogate& sg; //!< Surrogate whose grid maps the poses are scored against.
+};
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef IGROW_PHILOX_HPP
+#define IGROW_PHILOX_HPP
+
+#include <cstdint>
+#include <array>
+using namespace std;
+
+// Visual Studio 2013 does not support constexpr, which the distributions of libstdc++ require of min() and max().
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define IGROW_CONSTEXPR
+#else
+#define IGROW_CONSTEXPR constexpr
+#endif
+
+//! Represents a Philox4x32-10 counter-based random number generator, which encrypts a 128-bit counter with a 64-bit key in 10 rounds of multiplication and exclusive or.
+//! Every (seed, generation, index, attempt) tuple selects an independent stream, so constructing a generator costs nothing and the random choices of a child do not depend on the thread that makes them.
+class philox
+{
+public:
+	typedef uint64_t result_type;
+
+	//! Constructs the stream of a seed for the attempt-th attempt to create the index-th child of a generation.
+	explicit philox(const uint64_t seed, const uint32_t generation, const uint32_t index, const uint32_t attempt) : key({ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) }), counter({ 0, attempt, index, generation }), position(2) {}
+
+	//! Returns the smallest value that operator() may return.
+	static IGROW_CONSTEXPR result_type min()
+	{
+		return 0;
+	}
+
+	//! Returns the largest value that operator() may return.
+	static IGROW_CONSTEXPR result_type max()
+	{
+		return UINT64_MAX;
+	}
+
+	//! Returns the next 64 random bits of the stream, encrypting the next counter every two calls.
+	result_type operator()()
+	{
+		if (position == 2)
+		{
+			block = encrypt(counter, key);
+			++counter[0];
+			position = 0;
+		}
+		const result_type r = static_cast<result_type>(block[2 * position]) << 32 | block[2 * position + 1];
+		++position;
+		return r;
+	}
+
+	//! Encrypts a counter with a key by 10 Philox rounds.
+	static array<uint32_t, 4> encrypt(array<uint32_t, 4> c, array<uint32_t, 2> k)
+	{
+		for (size_t round = 0; round < 10; ++round)
+		{
+			const uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * c[0];
+			const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * c[2];
+			c = { static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<uint32_t>(p1), static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<uint32_t>(p0) };
+			k[0] += 0x9E3779B9;
+			k[1] += 0xBB67AE85;
+		}
+		return c;
+	}
+
+private:
+	const array<uint32_t, 2> key; //!< Key derived from the seed.
+	array<uint32_t, 4> counter; //!< Counter of the next block, consisting of the block number, the attempt, the index and the generation.
+	array<uint32_t, 4> block; //!< Current block of random bits.
+	size_t position; //!< Number of 64-bit halves of the current block consumed.
+};
+
+#endif
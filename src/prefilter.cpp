@@ -0,0 +1,33 @@
+#include <algorithm>
+#include "scoring_function.hpp"
+#include "prefilter.hpp"
+
+const double prefilter::fallback_vdw_radius = 2.0;
+
+prefilter::prefilter(const path& receptor_path, const box& b, const double max_overlap) : rec(receptor_path), b(b), max_overlap(max_overlap), max_vdw_radius(*max_element(scoring_function::xs_vdw_radii.cbegin(), scoring_function::xs_vdw_radii.cend()))
+{
+}
+
+bool prefilter::operator()(const ligand& l) const
+{
+	for (const auto& a : l.atoms)
+	{
+		if (a.is_hydrogen()) continue;
+		if (!b.within(a.coordinate)) return false;
+
+		// The van der Waals radius of a heavy atom only depends on its element, so bonding is irrelevant here.
+		const size_t t = scoring_function::xs(a.ad, false, false);
+		const double r = t == scoring_function::n ? fallback_vdw_radius : scoring_function::xs_vdw_radii[t];
+		// The query radius assumes the largest van der Waals radius for receptor atoms. A tolerated overlap as large as the radius sum admits any distance.
+		const double radius = r + max_vdw_radius - max_overlap;
+		if (radius <= 0) continue;
+		bool clash = false;
+		rec.for_each_neighbor(a.coordinate, radius, [&](const size_t i)
+		{
+			const double d = r + scoring_function::xs_vdw_radii[rec.xs[i]] - max_overlap;
+			if (d > 0 && distance_sqr(a.coordinate, rec.atoms[i].coordinate) < d * d) clash = true;
+		});
+		if (clash) return false;
+	}
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef IGROW_PREFILTER_HPP
+#define IGROW_PREFILTER_HPP
+
+#include "box.hpp"
+#include "receptor.hpp"
+#include "ligand.hpp"
+
+//! Represents a cheap geometric feasibility filter, which rejects ligands whose heavy atoms leave the box or deeply overlap the receptor.
+class prefilter
+{
+public:
+	static const double fallback_vdw_radius; //!< Van der Waals radius assumed for heavy atoms whose element has no X-Score atom type, e.g. metals.
+
+	//! Constructs a prefilter by parsing a receptor and hashing its heavy atoms.
+	explicit prefilter(const path& receptor_path, const box& b, const double max_overlap);
+
+	//! Returns true if all the heavy atoms of a ligand are within the box and none of them overlaps a receptor heavy atom by more than max_overlap.
+	bool operator()(const ligand& l) const;
+
+private:
+	const receptor rec; //!< Receptor whose heavy atoms are spatially hashed.
+	const box b; //!< Box within which heavy atoms must stay.
+	const double max_overlap; //!< Maximum tolerated overlap of van der Waals spheres.
+	const double max_vdw_radius; //!< Largest van der Waals radius of X-Score atom types, which bounds the radius of receptor atoms in neighbor queries.
+};
+
+#endif
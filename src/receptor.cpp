@@ -0,0 +1,73 @@
+#include <boost/filesystem/fstream.hpp>
+#include <boost/algorithm/string.hpp>
+#include "scoring_function.hpp"
+#include "receptor.hpp"
+
+const double receptor::cell_size = 4;
+
+receptor::receptor(const path& p)
+{
+	// All atoms, including hydrogens, are needed to determine X-Score atom types.
+	vector<atom> all_atoms;
+	vector<bool> bonded_to_heteroatom, bonded_to_hd;
+	all_atoms.reserve(5000); // A receptor typically consists of <= 5,000 atoms.
+	bonded_to_heteroatom.reserve(5000);
+	bonded_to_hd.reserve(5000);
+
+	// Parse ATOM/HETATM. Covalent bonds are only searched within the same residue.
+	string residue = "XXXXXXXXXX"; // Columns from 1-based [18, 27], i.e. residue name, chain ID, residue sequence number and insertion code.
+	size_t residue_start = 0; // The starting index of atoms of the current residue.
+	string line;
+	line.reserve(79);
+	boost::filesystem::ifstream ifs(p);
+	while (getline(ifs, line))
+	{
+		const string record = line.substr(0, 6);
+		if (record != "ATOM  " && record != "HETATM") continue;
+
+		// Skip atoms of unsupported AutoDock4 types.
+		const size_t ad = atom::parse_ad_string(line.substr(77, isspace(line[78]) ? 1 : 2));
+		if (ad == atom::n) continue;
+
+		// Start a new residue if necessary.
+		if (line.compare(17, 10, residue))
+		{
+			residue = line.substr(17, 10);
+			residue_start = all_atoms.size();
+		}
+
+		// Parse the ATOM/HETATM line into an atom.
+		string name = line.substr(12, 4);
+		boost::algorithm::trim(name);
+		all_atoms.push_back(atom(name, line.substr(12, 18), line.substr(54), stoul(line.substr(6, 5)), {stod(line.substr(30, 8)), stod(line.substr(38, 8)), stod(line.substr(46, 8))}, ad));
+		bonded_to_heteroatom.push_back(false);
+		bonded_to_hd.push_back(false);
+
+		// Find covalent bonds to previous atoms of the same residue.
+		const size_t i = all_atoms.size() - 1;
+		const atom& a = all_atoms[i];
+		for (size_t j = residue_start; j < i; ++j)
+		{
+			const atom& b = all_atoms[j];
+			if (!a.is_neighbor(b)) continue;
+			if (a.ad == 1 && scoring_function::is_heteroatom(b.ad)) bonded_to_hd[j] = true;
+			if (b.ad == 1 && scoring_function::is_heteroatom(a.ad)) bonded_to_hd[i] = true;
+			if (scoring_function::is_heteroatom(a.ad)) bonded_to_heteroatom[j] = true;
+			if (scoring_function::is_heteroatom(b.ad)) bonded_to_heteroatom[i] = true;
+		}
+	}
+	ifs.close();
+
+	// Keep the heavy atoms of supported X-Score types and hash them into cells.
+	atoms.reserve(all_atoms.size());
+	xs.reserve(all_atoms.size());
+	for (size_t i = 0; i < all_atoms.size(); ++i)
+	{
+		const atom& a = all_atoms[i];
+		const size_t t = scoring_function::xs(a.ad, bonded_to_heteroatom[i], bonded_to_hd[i]);
+		if (t == scoring_function::n) continue;
+		cells[key_of(cell_of(a.coordinate))].push_back(atoms.size());
+		atoms.push_back(a);
+		xs.push_back(t);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef IGROW_RECEPTOR_HPP
+#define IGROW_RECEPTOR_HPP
+
+#include <cmath>
+#include <vector>
+#include <unordered_map>
+#include <boost/filesystem/path.hpp>
+#include "array.hpp"
+#include "atom.hpp"
+using boost::filesystem::path;
+
+//! Represents a receptor, whose heavy atoms are spatially hashed into cubic cells for fast neighbor queries.
+class receptor
+{
+public:
+	static const double cell_size; //!< Edge length of a cubic cell of the spatial hash.
+	vector<atom> atoms; //!< Heavy atoms.
+	vector<size_t> xs; //!< X-Score atom types of the heavy atoms.
+
+	//! Constructs a receptor by parsing a given receptor file in PDBQT.
+	explicit receptor(const path& p);
+
+	//! Invokes f with the index of every heavy atom within radius of a coordinate.
+	template <typename F>
+	void for_each_neighbor(const array<double, 3>& coordinate, const double radius, F f) const
+	{
+		const double radius_sqr = radius * radius;
+		const array<int, 3> c0 = cell_of({ coordinate[0] - radius, coordinate[1] - radius, coordinate[2] - radius });
+		const array<int, 3> c1 = cell_of({ coordinate[0] + radius, coordinate[1] + radius, coordinate[2] + radius });
+		for (int x = c0[0]; x <= c1[0]; ++x)
+		for (int y = c0[1]; y <= c1[1]; ++y)
+		for (int z = c0[2]; z <= c1[2]; ++z)
+		{
+			const auto it = cells.find(key_of({ x, y, z }));
+			if (it == cells.end()) continue;
+			for (const size_t i : it->second)
+			{
+				if (distance_sqr(coordinate, atoms[i].coordinate) < radius_sqr) f(i);
+			}
+		}
+	}
+
+private:
+	unordered_map<size_t, vector<size_t>> cells; //!< Spatial hash from cell keys to indexes of heavy atoms.
+
+	//! Returns the cell to which a coordinate belongs.
+	static array<int, 3> cell_of(const array<double, 3>& coordinate)
+	{
+		return
+		{
+			static_cast<int>(floor(coordinate[0] / cell_size)),
+			static_cast<int>(floor(coordinate[1] / cell_size)),
+			static_cast<int>(floor(coordinate[2] / cell_size)),
+		};
+	}
+
+	//! Packs the three cell indexes into a hash key.
+	static size_t key_of(const array<int, 3>& cell)
+	{
+		return (static_cast<size_t>(cell[0] + (1 << 20)) << 42) | (static_cast<size_t>(cell[1] + (1 << 20)) << 21) | static_cast<size_t>(cell[2] + (1 << 20));
+	}
+};
+
+#endif
@@ -0,0 +1,303 @@
+#include <cmath>
+#include <queue>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <iostream>
+#include <algorithm>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include "scheduler.hpp"
+using namespace boost::filesystem;
+
+const double scheduler::min_timeout = 10;
+
+//! Maximum number of recent ratios of observed over predicted wall times to keep.
+static const size_t max_ratios = 100;
+
+//! Returns true if a docked ligand file is complete, i.e. its first model is terminated by TORSDOF, as a killed idock may leave a partially written file.
+static bool is_complete(const path& p)
+{
+	if (!exists(p)) return false;
+	boost::filesystem::ifstream ifs(p);
+	string line;
+	while (getline(ifs, line))
+	{
+		if (line.compare(0, 7, "TORSDOF") == 0) return true;
+	}
+	return false;
+}
+
+scheduler::scheduler(const docker& dock, const size_t num_jobs, const size_t num_cpus, const size_t max_retries, const double straggler_factor) : num_jobs(num_jobs), max_retries(max_retries), straggler_factor(straggler_factor), dock(dock), num_observations(0)
+{
+	// Partition the CPUs into contiguous sets of nearly equal size, sharing CPUs round robin if there are more jobs than CPUs.
+	cpu_sets.resize(num_jobs);
+	for (size_t k = 0; k < num_jobs; ++k)
+	{
+		const size_t b = k * num_cpus / num_jobs;
+		const size_t e = max(b + 1, (k + 1) * num_cpus / num_jobs);
+		for (size_t c = b; c < e; ++c)
+		{
+			cpu_sets[k].push_back(c % num_cpus);
+		}
+	}
+
+	// Start with a prior in arbitrary units, which only matters for the relative order of ligands until the first jobs have been observed.
+	w = { 0, 1, 1, 0.1 };
+	xtx.fill(0);
+	xty.fill(0);
+}
+
+double scheduler::predict(const ligand& l) const
+{
+	return w[1] + w[2] * l.num_rotatable_bonds + w[3] * l.num_heavy_atoms;
+}
+
+double scheduler::timeout(const array<double, n>& x) const
+{
+	// Impose no limit until the model has been fitted to observed wall times.
+	if (straggler_factor <= 0 || ratios.size() < n) return 0;
+	vector<double> r(ratios.cbegin(), ratios.cend());
+	const auto p95 = r.begin() + (r.size() * 95 / 100);
+	nth_element(r.begin(), p95, r.end());
+	double t = 0;
+	for (size_t i = 0; i < n; ++i) t += w[i] * x[i];
+	return max(min_timeout, straggler_factor * t * max(*p95, 1.0));
+}
+
+void scheduler::learn(const array<double, n>& x, const double t)
+{
+	// Record how the observed wall time compares to the prediction once the model is in units of seconds.
+	if (num_observations >= n)
+	{
+		double p = 0;
+		for (size_t i = 0; i < n; ++i) p += w[i] * x[i];
+		if (p > 0)
+		{
+			ratios.push_back(t / p);
+			if (ratios.size() > max_ratios) ratios.pop_front();
+		}
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		for (size_t j = 0; j < n; ++j)
+		{
+			xtx[i * n + j] += x[i] * x[j];
+		}
+		xty[i] += x[i] * t;
+	}
+	if (++num_observations < n) return;
+
+	// Solve the ridge-regularized normal equations by Gaussian elimination with partial pivoting.
+	array<double, n * n> a(xtx);
+	array<double, n> b(xty);
+	double trace = 0;
+	for (size_t i = 0; i < n; ++i) trace += a[i * n + i];
+	for (size_t i = 0; i < n; ++i) a[i * n + i] += 1e-9 * trace + 1e-12;
+	for (size_t c = 0; c < n; ++c)
+	{
+		size_t p = c;
+		for (size_t r = c + 1; r < n; ++r)
+		{
+			if (fabs(a[r * n + c]) > fabs(a[p * n + c])) p = r;
+		}
+		for (size_t j = 0; j < n; ++j) swap(a[c * n + j], a[p * n + j]);
+		swap(b[c], b[p]);
+		for (size_t r = c + 1; r < n; ++r)
+		{
+			const double f = a[r * n + c] / a[c * n + c];
+			for (size_t j = c; j < n; ++j) a[r * n + j] -= f * a[c * n + j];
+			b[r] -= f * b[c];
+		}
+	}
+	array<double, n> s;
+	for (size_t c = n; c-- > 0;)
+	{
+		double v = b[c];
+		for (size_t j = c + 1; j < n; ++j) v -= a[c * n + j] * s[j];
+		s[c] = v / a[c * n + c];
+	}
+
+	// Runtimes cannot decrease with more work, so clamp negative per-ligand weights, and keep the previous model if nothing is left.
+	for (size_t i = 0; i < n; ++i) s[i] = max(s[i], 0.0);
+	if (s[1] + s[2] + s[3] > 0) w = s;
+}
+
+int scheduler::operator()(const path& input_folder, const path& output_folder, const path& log_path, const vector<string>& filenames, const vector<const ligand*>& ligands, vector<size_t>& quarantined, const chrono::steady_clock::time_point deadline)
+{
+	quarantined.clear();
+	const bool bounded = deadline != chrono::steady_clock::time_point::max();
+	if (num_jobs == 1 && !max_retries && straggler_factor <= 0 && !bounded) return dock(input_folder, output_folder, log_path);
+
+	// Collect the present ligands.
+	vector<size_t> pending;
+	pending.reserve(ligands.size());
+	for (size_t i = 0; i < ligands.size(); ++i)
+	{
+		if (exists(input_folder / filenames[i])) pending.push_back(i);
+	}
+
+	const size_t num_present = pending.size();
+
+	// Dock the pending ligands round by round. Every retry round doubles the number of jobs, so that a pathological ligand is soon isolated in a job of its own.
+	vector<size_t> attempts(ligands.size());
+	vector<path> job_logs;
+	size_t num_killed = 0, num_failed = 0, num_requeued = 0, num_expired = 0;
+	int failure = 0;
+	for (size_t round = 0; !pending.empty(); ++round)
+	{
+		// Sort the pending ligands in descending order of predicted docking time.
+		vector<pair<double, size_t>> order;
+		order.reserve(pending.size());
+		for (const size_t i : pending)
+		{
+			order.push_back(make_pair(predict(*ligands[i]), i));
+		}
+		stable_sort(order.begin(), order.end(), [](const pair<double, size_t>& p0, const pair<double, size_t>& p1)
+		{
+			return p0.first > p1.first;
+		});
+
+		// Assign every ligand to the job of the least predicted load, linking it into the job folder.
+		const size_t num_round_jobs = min(pending.size(), num_jobs << min<size_t>(round, 16));
+		vector<path> job_folders(num_round_jobs);
+		vector<vector<size_t>> members(num_round_jobs);
+		vector<array<double, n>> features(num_round_jobs);
+		priority_queue<pair<double, size_t>, vector<pair<double, size_t>>, greater<pair<double, size_t>>> loads;
+		for (size_t k = 0; k < num_round_jobs; ++k)
+		{
+			job_folders[k] = input_folder / ("job" + to_string(round) + "-" + to_string(k));
+			create_directory(job_folders[k]);
+			features[k] = { 1, 0, 0, 0 };
+			loads.push(make_pair(0.0, k));
+		}
+		for (const auto& o : order)
+		{
+			const auto load = loads.top();
+			loads.pop();
+			const size_t k = load.second;
+			const ligand& l = *ligands[o.second];
+			create_hard_link(input_folder / filenames[o.second], job_folders[k] / filenames[o.second]);
+			members[k].push_back(o.second);
+			features[k][1] += 1;
+			features[k][2] += l.num_rotatable_bonds;
+			features[k][3] += l.num_heavy_atoms;
+			loads.push(make_pair(load.first + o.first, k));
+		}
+
+		// Run the jobs by at most num_jobs concurrent workers, each pinned to its own CPU set, measuring their wall times.
+		vector<int> exit_codes(num_round_jobs);
+		vector<double> elapsed(num_round_jobs);
+		vector<double> limits(num_round_jobs);
+		vector<chrono::steady_clock::time_point> finished(num_round_jobs);
+		for (size_t k = 0; k < num_round_jobs; ++k)
+		{
+			job_logs.push_back(log_path);
+			job_logs.back() += "." + to_string(round) + "-" + to_string(k);
+			limits[k] = timeout(features[k]);
+		}
+		const size_t first_log = job_logs.size() - num_round_jobs;
+		atomic<size_t> next(0);
+		vector<future<void>> workers;
+		for (size_t c = 0; c < min(num_jobs, num_round_jobs); ++c)
+		{
+			workers.push_back(async(launch::async, [&, c]()
+			{
+				for (size_t k; (k = next++) < num_round_jobs;)
+				{
+					// Cap the limit of the job by the time remaining until the deadline, skipping the job if none remains.
+					const auto start = chrono::steady_clock::now();
+					if (bounded)
+					{
+						const double remaining = chrono::duration<double>(deadline - start).count();
+						if (remaining <= 0)
+						{
+							exit_codes[k] = docker::timed_out;
+							finished[k] = start;
+							continue;
+						}
+						if (limits[k] <= 0 || remaining < limits[k]) limits[k] = remaining;
+					}
+					exit_codes[k] = dock(job_folders[k], output_folder, job_logs[first_log + k], num_jobs > 1 ? cpu_sets[c] : vector<size_t>(), limits[k]);
+					finished[k] = chrono::steady_clock::now();
+					elapsed[k] = chrono::duration<double>(finished[k] - start).count();
+				}
+			}));
+		}
+		for (auto& f : workers)
+		{
+			f.get();
+		}
+
+		// Learn from the successful jobs, and requeue or quarantine the ligands left undocked, which may be partially written by a killed idock. Ligands of the jobs killed or skipped at the deadline are left undocked.
+		vector<size_t> requeued;
+		size_t num_round_failed = 0, num_round_docked = 0;
+		for (size_t k = 0; k < num_round_jobs; ++k)
+		{
+			const bool expired = bounded && exit_codes[k] == docker::timed_out && finished[k] >= deadline;
+			if (expired) ++num_expired;
+			else if (exit_codes[k] == docker::timed_out) ++num_killed;
+			else if (exit_codes[k]) ++num_failed, ++num_round_failed;
+			else learn(features[k], elapsed[k]);
+			if (exit_codes[k] && !expired) failure = exit_codes[k];
+			for (const size_t i : members[k])
+			{
+				const path p = output_folder / filenames[i];
+				if (is_complete(p))
+				{
+					++num_round_docked;
+					continue;
+				}
+				if (exists(p)) remove(p);
+				if (expired) continue;
+				if (++attempts[i] > max_retries)
+				{
+					quarantined.push_back(i);
+				}
+				else
+				{
+					requeued.push_back(i);
+				}
+			}
+			remove_all(job_folders[k]);
+		}
+
+		// Give up if every job of the first round has failed without docking any ligand, as idock itself is then broken, e.g. by a wrong configuration, rather than by some pathological ligands.
+		if (!round && num_round_failed == num_round_jobs && !num_round_docked)
+		{
+			quarantined.insert(quarantined.end(), requeued.cbegin(), requeued.cend());
+			break;
+		}
+		num_requeued += requeued.size();
+		pending.swap(requeued);
+	}
+	if (num_expired) cout << "Killed or skipped " << num_expired << " idock jobs at the wall-clock deadline, leaving their ligands undocked" << endl;
+	if (num_killed || num_failed) cout << "Killed " << num_killed << " straggling and detected " << num_failed << " failed idock jobs, requeued " << num_requeued << " ligands and quarantined " << quarantined.size() << endl;
+	sort(quarantined.begin(), quarantined.end());
+
+	// Merge the job logs into one, keeping the header of the first one only.
+	boost::filesystem::ofstream ofs(log_path);
+	bool header = true;
+	for (const auto& job_log : job_logs)
+	{
+		if (!exists(job_log)) continue;
+		boost::filesystem::ifstream ifs(job_log);
+		string line;
+		if (getline(ifs, line) && header)
+		{
+			ofs << line << '\n';
+			header = false;
+		}
+		while (getline(ifs, line))
+		{
+			ofs << line << '\n';
+		}
+		ifs.close();
+		remove(job_log);
+	}
+
+	// Report the failure of idock if no ligand has been docked at all.
+	if (num_present && quarantined.size() == num_present) return failure ? failure : 1;
+	return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef IGROW_SCHEDULER_HPP
+#define IGROW_SCHEDULER_HPP
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include "docker.hpp"
+#include "ligand.hpp"
+
+//! Represents a docking scheduler, which splits the ligands of a generation into concurrent idock jobs pinned to disjoint CPU sets.
+//! Ligands are assigned to jobs longest-processing-time-first by a runtime model linear in their numbers of rotatable bonds and heavy atoms.
+//! The model is learned online from the measured wall time of every job by least squares.
+//! Jobs that fail or straggle beyond a wall-clock limit derived from the observed runtimes are killed, and their undocked ligands are requeued into smaller jobs until they exceed a retry limit and are quarantined.
+class scheduler
+{
+public:
+	static const double min_timeout; //!< Minimum wall-clock limit of a job in seconds.
+	const size_t num_jobs; //!< Number of concurrent idock jobs.
+	const size_t max_retries; //!< Maximum number of times an undocked ligand is requeued.
+	const double straggler_factor; //!< Factor of the predicted wall time of a job, scaled by the 95th percentile of observed over predicted times, beyond which the job is killed. 0 disables the limit.
+
+	//! Constructs a scheduler that runs num_jobs concurrent idock jobs over num_cpus CPUs.
+	explicit scheduler(const docker& dock, const size_t num_jobs, const size_t num_cpus, const size_t max_retries, const double straggler_factor);
+
+	//! Docks the given ligands, whose files in the input folder are named by the leading filenames, skipping absent files, and writes the docked ligands into the output folder and the merged idock log into the log path.
+	//! Indexes of the ligands that failed to dock more than max_retries times are returned in quarantined, and their docked files are absent.
+	//! If every job of the first round fails without docking any ligand, the remaining ligands are quarantined at once rather than retried.
+	//! Jobs still running at the deadline are killed and jobs not yet started are skipped, leaving their ligands undocked without retrying or quarantining them.
+	//! @return The exit code of idock if a single job without retries or deadline is run, otherwise a non-zero exit code of a failed job, or 1, if every present ligand has been quarantined, or 0.
+	int operator()(const path& input_folder, const path& output_folder, const path& log_path, const vector<string>& filenames, const vector<const ligand*>& ligands, vector<size_t>& quarantined, const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+	//! Returns the predicted docking time of a ligand, excluding the constant overhead of its job.
+	double predict(const ligand& l) const;
+
+private:
+	static const size_t n = 4; //!< Number of model features, i.e. one job, its number of ligands, their total rotatable bonds and their total heavy atoms.
+	const docker& dock; //!< Docking engine.
+	vector<vector<size_t>> cpu_sets; //!< CPUs assigned to every concurrent job.
+	array<double, n> w; //!< Model weights.
+	array<double, n * n> xtx; //!< Accumulated Gram matrix of the job features.
+	array<double, n> xty; //!< Accumulated products of the job features and wall times.
+	size_t num_observations; //!< Number of jobs observed.
+	deque<double> ratios; //!< Recent ratios of observed over predicted wall times of jobs.
+
+	//! Returns the wall-clock limit of a job in seconds given its features, or 0 if there is no limit.
+	double timeout(const array<double, n>& x) const;
+
+	//! Updates the model with the features and the wall time of a job.
+	void learn(const array<double, n>& x, const double t);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include <cmath>
+#include "scoring_function.hpp"
+
+//! Van der Waals radii of X-Score atom types.
+const array<double, scoring_function::n> scoring_function::xs_vdw_radii =
+{
+	1.9, //  0 = C_H
+	1.9, //  1 = C_P
+	1.8, //  2 = N_P
+	1.8, //  3 = N_D
+	1.8, //  4 = N_A
+	1.8, //  5 = N_DA
+	1.7, //  6 = O_A
+	1.7, //  7 = O_DA
+	2.0, //  8 = S_P
+	2.1, //  9 = P_P
+	1.5, // 10 = F_H
+	1.8, // 11 = Cl_H
+	2.0, // 12 = Br_H
+	2.2, // 13 = I_H
+	1.2, // 14 = Met_D
+};
+
+const double scoring_function::cutoff = 8;
+const double scoring_function::cutoff_sqr = cutoff * cutoff;
+
+size_t scoring_function::xs(const size_t ad, const bool bonded_to_heteroatom, const bool bonded_to_hd)
+{
+	switch (ad)
+	{
+		case  2: // C
+		case  3: // A
+			return bonded_to_heteroatom ? 1 : 0;
+		case  4: // N
+			return bonded_to_hd ? 3 : 2;
+		case  5: // NA
+			return bonded_to_hd ? 5 : 4;
+		case  6: // OA
+			return bonded_to_hd ? 7 : 6;
+		case  7: // S
+		case  8: // SA
+			return 8;
+		case 10: // P
+			return 9;
+		case 11: // F
+			return 10;
+		case 12: // Cl
+			return 11;
+		case 13: // Br
+			return 12;
+		case 14: // I
+			return 13;
+		case 15: // Zn
+		case 16: // Fe
+		case 17: // Mg
+		case 18: // Ca
+		case 19: // Mn
+			return 14;
+		default: // H, HD, Se and other metals are not supported.
+			return n;
+	}
+}
+
+bool scoring_function::is_hydrophobic(const size_t xs)
+{
+	return xs == 0 || (10 <= xs && xs <= 13);
+}
+
+bool scoring_function::is_donor(const size_t xs)
+{
+	return xs == 3 || xs == 5 || xs == 7 || xs == 14;
+}
+
+bool scoring_function::is_acceptor(const size_t xs)
+{
+	return xs == 4 || xs == 5 || xs == 6 || xs == 7;
+}
+
+double scoring_function::e(const size_t t1, const size_t t2, const double r)
+{
+	// Calculate the surface distance.
+	const double d = r - (xs_vdw_radii[t1] + xs_vdw_radii[t2]);
+
+	// Steric terms.
+	double e = -0.035579 * exp(-4 * d * d) - 0.005156 * exp(-0.25 * (d - 3) * (d - 3));
+	if (d < 0) e += 0.840245 * d * d;
+
+	// Hydrophobic term.
+	if (is_hydrophobic(t1) && is_hydrophobic(t2))
+	{
+		e -= 0.035069 * (d < 0.5 ? 1 : (d < 1.5 ? 1.5 - d : 0));
+	}
+
+	// Hydrogen bonding term.
+	if ((is_donor(t1) && is_acceptor(t2)) || (is_donor(t2) && is_acceptor(t1)))
+	{
+		e -= 0.587439 * (d < -0.7 ? 1 : (d < 0 ? d / -0.7 : 0));
+	}
+	return e;
+}
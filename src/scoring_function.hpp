@@ -0,0 +1,45 @@
+#pragma once
+#ifndef IGROW_SCORING_FUNCTION_HPP
+#define IGROW_SCORING_FUNCTION_HPP
+
+#include <array>
+using namespace std;
+
+//! Represents an empirical scoring function of the AutoDock Vina family, evaluated between X-Score atom types.
+class scoring_function
+{
+public:
+	static const size_t n = 15; //!< Number of X-Score atom types.
+	static const array<double, n> xs_vdw_radii; //!< Van der Waals radii of X-Score atom types.
+	static const double cutoff; //!< Cutoff distance beyond which pairwise interactions are ignored.
+	static const double cutoff_sqr; //!< Square of cutoff.
+
+	//! Returns the X-Score atom type of an AutoDock4 atom type, or n if the AutoDock4 atom type is not supported, e.g. hydrogens.
+	static size_t xs(const size_t ad, const bool bonded_to_heteroatom, const bool bonded_to_hd);
+
+	//! Returns true if the AutoDock4 atom type counts as a heteroatom when determining the X-Score type of a bonded carbon.
+	static bool is_heteroatom(const size_t ad)
+	{
+		return 4 <= ad && ad <= 6;
+	}
+
+	//! Returns true if the X-Score atom type is hydrophobic.
+	static bool is_hydrophobic(const size_t xs);
+
+	//! Returns true if the X-Score atom type is a hydrogen bond donor.
+	static bool is_donor(const size_t xs);
+
+	//! Returns true if the X-Score atom type is a hydrogen bond acceptor.
+	static bool is_acceptor(const size_t xs);
+
+	//! Returns the interaction energy between two atoms of the given X-Score types at distance r.
+	static double e(const size_t t1, const size_t t2, const double r);
+
+	//! Normalizes an intermolecular energy into a predicted free energy given the number of rotatable bonds of the ligand.
+	static double normalize(const double e_inter, const size_t num_rotatable_bonds)
+	{
+		return e_inter / (1 + 0.05846 * num_rotatable_bonds);
+	}
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <thread>
+#include <boost/program_options.hpp>
+#include <boost/process/search_path.hpp>
+#include "broker.hpp"
+
+//! Runs a docking broker that serves idock jobs to igrow clients on the same node.
+int main(int argc, char* argv[])
+{
+	path socket_path;
+	size_t num_workers, num_cpus;
+
+	// Process program options.
+	try
+	{
+		// Initialize the default values of optional arguments.
+		const size_t default_num_workers = 1;
+		const size_t default_num_cpus = max<size_t>(thread::hardware_concurrency(), 1);
+
+		using namespace boost::program_options;
+		options_description all_options("options");
+		all_options.add_options()
+			("socket", value<path>(&socket_path)->required(), "path to the Unix domain socket to listen on")
+			("workers", value<size_t>(&num_workers)->default_value(default_num_workers), "number of concurrent idock workers, pinned to disjoint CPU sets")
+			("cpus", value<size_t>(&num_cpus)->default_value(default_num_cpus), "number of CPUs shared by the workers")
+			("help", "help information")
+			;
+
+		// If no command line argument is supplied or help is requested, print the usage and exit.
+		variables_map vm;
+		store(parse_command_line(argc, argv, all_options), vm);
+		if (argc == 1 || vm.count("help"))
+		{
+			cout << "Usage: igrow-broker --socket <path> [options]" << endl;
+			cout << all_options;
+			return 0;
+		}
+
+		// Notify the user of parsing errors, if any.
+		vm.notify();
+
+		// Validate miscellaneous options.
+		if (!num_workers)
+		{
+			cerr << "Option workers must be 1 or greater" << endl;
+			return 1;
+		}
+		if (!num_cpus)
+		{
+			cerr << "Option cpus must be 1 or greater" << endl;
+			return 1;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	try
+	{
+		// Find the full path to idock executable.
+		const path idock_path = path(boost::process::search_path("idock")).make_preferred();
+		cout << "Using idock executable at " << idock_path << endl;
+		cout << "Serving " << num_workers << " idock workers over " << num_cpus << " CPUs at " << socket_path << endl;
+		broker(socket_path, idock_path, num_workers, num_cpus).run();
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+}
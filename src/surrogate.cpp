@@ -0,0 +1,144 @@
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include "safe_counter.hpp"
+#include "array.hpp"
+#include "scoring_function.hpp"
+#include "hash.hpp"
+#include "surrogate.hpp"
+using namespace boost::filesystem;
+using namespace boost::interprocess;
+
+const double surrogate::out_of_box_penalty = 1;
+
+//! Magic bytes identifying the format of a cached grid file.
+static const char grid_magic[8] = { 'i', 'g', 'r', 'o', 'w', 'g', 'd', '1' };
+
+surrogate::surrogate(const path& receptor_path, const box& b, const path& cache_folder, io_service_pool& io) : b(b)
+{
+	const size_t num_probes = b.num_probes_product();
+	const size_t header_size = sizeof(grid_magic) + sizeof(b.num_probes);
+	const size_t cache_size = header_size + sizeof(float) * scoring_function::n * num_probes;
+
+	// Key the cache file by the receptor content and the box.
+	size_t h = fnv1a(receptor_path, fnv1a_basis);
+	h = fnv1a(reinterpret_cast<const char*>(b.center.data()), sizeof(b.center), h);
+	h = fnv1a(reinterpret_cast<const char*>(b.span.data()), sizeof(b.span), h);
+	h = fnv1a(reinterpret_cast<const char*>(&b.granularity), sizeof(b.granularity), h);
+	ostringstream oss;
+	oss << hex << setfill('0') << setw(16) << h << ".grid";
+	const path cache_path = cache_folder / oss.str();
+
+	// Precompute and cache the grid maps if they are absent.
+	if (!exists(cache_path) || file_size(cache_path) != cache_size)
+	{
+		const receptor rec(receptor_path);
+		vector<float> data(scoring_function::n * num_probes);
+		const size_t nx = b.num_probes[0], ny = b.num_probes[1], nz = b.num_probes[2];
+		safe_counter<size_t> cnt;
+		cnt.init(nz);
+		for (size_t z = 0; z < nz; ++z)
+		{
+			io.post([&, z]()
+			{
+				array<double, scoring_function::n> acc;
+				for (size_t y = 0; y < ny; ++y)
+				for (size_t x = 0; x < nx; ++x)
+				{
+					const array<double, 3> probe = { b.corner0[0] + b.granularity * x, b.corner0[1] + b.granularity * y, b.corner0[2] + b.granularity * z };
+					acc.fill(0);
+					rec.for_each_neighbor(probe, scoring_function::cutoff, [&](const size_t i)
+					{
+						const double r = sqrt(distance_sqr(probe, rec.atoms[i].coordinate));
+						for (size_t t = 0; t < scoring_function::n; ++t)
+						{
+							acc[t] += scoring_function::e(t, rec.xs[i], r);
+						}
+					});
+					for (size_t t = 0; t < scoring_function::n; ++t)
+					{
+						data[((t * nz + z) * ny + y) * nx + x] = static_cast<float>(acc[t]);
+					}
+				}
+				cnt.increment();
+			});
+		}
+		cnt.wait();
+
+		// Write to a temporary file first so that concurrent runs never map a partially written cache.
+		create_directories(cache_folder);
+		const path tmp_path = cache_folder / unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+		boost::filesystem::ofstream ofs(tmp_path, ios::binary);
+		ofs.write(grid_magic, sizeof(grid_magic));
+		ofs.write(reinterpret_cast<const char*>(b.num_probes.data()), sizeof(b.num_probes));
+		ofs.write(reinterpret_cast<const char*>(data.data()), sizeof(float) * data.size());
+		ofs.close();
+		rename(tmp_path, cache_path);
+	}
+
+	// Memory-map the cache file.
+	fm = file_mapping(cache_path.string().c_str(), read_only);
+	mr = mapped_region(fm, read_only);
+	const char* const region = static_cast<const char*>(mr.get_address());
+	if (memcmp(region, grid_magic, sizeof(grid_magic)) || memcmp(region + sizeof(grid_magic), b.num_probes.data(), sizeof(b.num_probes))) throw domain_error("Invalid grid cache file " + cache_path.string());
+	maps = reinterpret_cast<const float*>(region + header_size);
+}
+
+vector<size_t> surrogate::xs(const ligand& l)
+{
+	vector<size_t> types(l.num_atoms);
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		const atom& a = l.atoms[i];
+		bool bonded_to_heteroatom = false, bonded_to_hd = false;
+		for (size_t j = 0; j < l.num_atoms; ++j)
+		{
+			if (i == j) continue;
+			const atom& b = l.atoms[j];
+			if (!a.is_neighbor(b)) continue;
+			if (scoring_function::is_heteroatom(b.ad)) bonded_to_heteroatom = true;
+			if (b.ad == 1) bonded_to_hd = true;
+		}
+		types[i] = scoring_function::xs(a.ad, bonded_to_heteroatom, bonded_to_hd);
+	}
+	return types;
+}
+
+double surrogate::e(const size_t t, const array<double, 3>& coordinate) const
+{
+	if (!b.within(coordinate)) return out_of_box_penalty;
+
+	// Find the grid cell enclosing the coordinate and the fractional offsets within it.
+	array<size_t, 3> i0;
+	array<double, 3> f;
+	for (size_t d = 0; d < 3; ++d)
+	{
+		const double p = (coordinate[d] - b.corner0[d]) * b.granularity_inv;
+		i0[d] = min(static_cast<size_t>(p), b.num_probes[d] - 2);
+		f[d] = p - i0[d];
+	}
+
+	// Interpolate trilinearly among the 8 corners of the grid cell.
+	const size_t nx = b.num_probes[0], ny = b.num_probes[1], nz = b.num_probes[2];
+	const float* const m = maps + ((t * nz + i0[2]) * ny + i0[1]) * nx + i0[0];
+	const size_t sy = nx, sz = nx * ny;
+	const double e00 = m[0      ] * (1 - f[0]) + m[1          ] * f[0];
+	const double e10 = m[sy     ] * (1 - f[0]) + m[sy + 1     ] * f[0];
+	const double e01 = m[sz     ] * (1 - f[0]) + m[sz + 1     ] * f[0];
+	const double e11 = m[sz + sy] * (1 - f[0]) + m[sz + sy + 1] * f[0];
+	return (e00 * (1 - f[1]) + e10 * f[1]) * (1 - f[2]) + (e01 * (1 - f[1]) + e11 * f[1]) * f[2];
+}
+
+double surrogate::score(const ligand& l) const
+{
+	const vector<size_t> types = xs(l);
+	double e_inter = 0;
+	for (size_t i = 0; i < l.num_atoms; ++i)
+	{
+		if (types[i] == scoring_function::n) continue;
+		e_inter += e(types[i], l.atoms[i].coordinate);
+	}
+	return scoring_function::normalize(e_inter, l.num_rotatable_bonds);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#ifndef IGROW_SURROGATE_HPP
+#define IGROW_SURROGATE_HPP
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "io_service_pool.hpp"
+#include "box.hpp"
+#include "receptor.hpp"
+#include "ligand.hpp"
+
+//! Represents an in-process surrogate of docking, which scores ligands in place against precomputed grid maps of a receptor.
+class surrogate
+{
+public:
+	static const double out_of_box_penalty; //!< Energy assigned to an atom located outside the box.
+	const box b; //!< Box over which the grid maps are precomputed.
+
+	//! Maps the grid maps of a receptor over a box from the cache folder, precomputing and caching them first if they are absent.
+	explicit surrogate(const path& receptor_path, const box& b, const path& cache_folder, io_service_pool& io);
+
+	//! Returns the X-Score atom types of the atoms of a ligand, with n denoting unsupported atoms such as hydrogens.
+	static vector<size_t> xs(const ligand& l);
+
+	//! Returns the trilinearly interpolated grid energy of an atom of X-Score type t at a coordinate.
+	double e(const size_t t, const array<double, 3>& coordinate) const;
+
+	//! Returns the predicted free energy of a ligand in its current pose.
+	double score(const ligand& l) const;
+
+private:
+	boost::interprocess::file_mapping fm; //!< Mapping of the cache file.
+	boost::interprocess::mapped_region mr; //!< Read-only view of the cache file.
+	const float* maps; //!< Grid maps laid out as [X-Score type][z][y][x].
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "tabu_memo.hpp"
+
+bool tabu_memo::contains(const operation& o)
+{
+	shard& s = shards[operation_hash()(o) % num_shards];
+	lock_guard<mutex> guard(s.m);
+	return s.operations.count(o) > 0;
+}
+
+void tabu_memo::insert(const operation& o)
+{
+	shard& s = shards[operation_hash()(o) % num_shards];
+	lock_guard<mutex> guard(s.m);
+	s.operations.insert(o);
+}
+
+void tabu_memo::retain(const unordered_set<size_t>& elites)
+{
+	for (auto& s : shards)
+	{
+		lock_guard<mutex> guard(s.m);
+		for (auto i = s.operations.begin(); i != s.operations.end();)
+		{
+			if (elites.count(i->p1) && (i->op != operation::crossover || elites.count(i->p2))) ++i;
+			else i = s.operations.erase(i);
+		}
+	}
+}
+
+size_t tabu_memo::size()
+{
+	size_t n = 0;
+	for (auto& s : shards)
+	{
+		lock_guard<mutex> guard(s.m);
+		n += s.operations.size();
+	}
+	return n;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef IGROW_TABU_MEMO_HPP
+#define IGROW_TABU_MEMO_HPP
+
+#include <mutex>
+#include <unordered_set>
+#include "ligand.hpp"
+
+//! Represents an operation on elites, i.e. its operator, the identities of its parents, and its choices of mutable atoms or rotatable bonds.
+class operation
+{
+public:
+	static const size_t addition = 0; //!< Operator of addition, whose second parent is a fragment index.
+	static const size_t subtraction = 1; //!< Operator of subtraction, which has no second parent.
+	static const size_t crossover = 2; //!< Operator of crossover, whose second parent is an elite.
+	size_t op; //!< Operator.
+	size_t p1; //!< Identity of parent 1.
+	size_t p2; //!< Identity of parent 2, or index to the fragment for addition.
+	size_t g1; //!< Choice on parent 1.
+	size_t g2; //!< Choice on parent 2.
+
+	//! Constructs an operation.
+	explicit operation(const size_t op, const size_t p1, const size_t p2, const size_t g1, const size_t g2) : op(op), p1(p1), p2(p2), g1(g1), g2(g2) {}
+
+	//! Returns the identity of an elite, which is unique during a run as every ligand is created by a distinct generation and index.
+	static size_t id(const ligand& l)
+	{
+		return static_cast<size_t>(l.id.key());
+	}
+
+	bool operator==(const operation& o) const
+	{
+		return op == o.op && p1 == o.p1 && p2 == o.p2 && g1 == o.g1 && g2 == o.g2;
+	}
+};
+
+//! Hashes an operation.
+class operation_hash
+{
+public:
+	size_t operator()(const operation& o) const
+	{
+		size_t h = o.op;
+		for (const size_t v : { o.p1, o.p2, o.g1, o.g2 })
+		{
+			h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+		}
+		return h;
+	}
+};
+
+//! Represents a concurrent memo of operations known to produce children rejected by deterministic checks, so that samplers skip them instead of rebuilding them.
+//! An operation stays tabu while its elite parents survive, as the children it produces depend only on the parents and the choices.
+class tabu_memo
+{
+public:
+	static const size_t num_shards = 64; //!< Number of shards, each guarded by its own mutex.
+	static const size_t max_skips = 64; //!< Number of tabu operations a sampler skips per failure it counts.
+
+	//! Returns true if an operation is known to be infeasible.
+	bool contains(const operation& o);
+
+	//! Memorizes an infeasible operation.
+	void insert(const operation& o);
+
+	//! Forgets the operations of which an elite parent is not among the given surviving elites.
+	void retain(const unordered_set<size_t>& elites);
+
+	//! Returns the number of memorized operations.
+	size_t size();
+
+private:
+	//! Represents a shard holding the operations whose hashes are congruent modulo the number of shards.
+	class shard
+	{
+	public:
+		mutex m; //!< Guards the operations of the shard.
+		unordered_set<operation, operation_hash> operations; //!< Infeasible operations.
+	};
+
+	array<shard, num_shards> shards; //!< Shards of the memo.
+};
+
+#endif
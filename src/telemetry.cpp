@@ -0,0 +1,159 @@
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__FreeBSD__)
+#include <malloc_np.h>
+#else
+#include <malloc.h>
+#endif
+#if defined(__linux__)
+#include <fstream>
+#endif
+#endif
+#include "telemetry.hpp"
+
+static atomic<bool> counting(false); //!< True if allocations are counted.
+static atomic<size_t> num_allocations(0); //!< Cumulative number of allocations.
+static atomic<size_t> num_deallocations(0); //!< Cumulative number of deallocations.
+static atomic<size_t> num_allocated_bytes(0); //!< Cumulative number of bytes allocated.
+static atomic<int64_t> num_live_bytes(0); //!< Number of bytes allocated minus deallocated.
+static atomic<int64_t> num_peak_live_bytes(0); //!< Peak of num_live_bytes.
+
+//! Returns the usable size of a block returned by malloc, which the allocator knows without a header of our own.
+static size_t usable_size(void* p)
+{
+#if defined(_WIN32)
+	return _msize(p);
+#elif defined(__APPLE__)
+	return malloc_size(p);
+#else
+	return malloc_usable_size(p);
+#endif
+}
+
+//! Allocates a block by malloc and counts it if requested.
+static void* allocate(const size_t n)
+{
+	void* const p = malloc(n ? n : 1);
+	if (!p) return p;
+	if (counting.load(memory_order_relaxed))
+	{
+		const size_t s = usable_size(p);
+		num_allocations.fetch_add(1, memory_order_relaxed);
+		num_allocated_bytes.fetch_add(s, memory_order_relaxed);
+		const int64_t live = num_live_bytes.fetch_add(s, memory_order_relaxed) + s;
+		int64_t peak = num_peak_live_bytes.load(memory_order_relaxed);
+		while (live > peak && !num_peak_live_bytes.compare_exchange_weak(peak, live, memory_order_relaxed));
+	}
+	return p;
+}
+
+//! Counts a block if requested and frees it.
+static void deallocate(void* p)
+{
+	if (!p) return;
+	if (counting.load(memory_order_relaxed))
+	{
+		num_deallocations.fetch_add(1, memory_order_relaxed);
+		num_live_bytes.fetch_sub(usable_size(p), memory_order_relaxed);
+	}
+	free(p);
+}
+
+void* operator new(size_t n)
+{
+	void* const p = allocate(n);
+	if (!p) throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t n)
+{
+	void* const p = allocate(n);
+	if (!p) throw bad_alloc();
+	return p;
+}
+
+void* operator new(size_t n, const nothrow_t&) throw()
+{
+	return allocate(n);
+}
+
+void* operator new[](size_t n, const nothrow_t&) throw()
+{
+	return allocate(n);
+}
+
+void operator delete(void* p) throw()
+{
+	deallocate(p);
+}
+
+void operator delete[](void* p) throw()
+{
+	deallocate(p);
+}
+
+void operator delete(void* p, const nothrow_t&) throw()
+{
+	deallocate(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) throw()
+{
+	deallocate(p);
+}
+
+void memory_usage::enable()
+{
+	counting = true;
+}
+
+void memory_usage::reset_peak()
+{
+	num_peak_live_bytes = num_live_bytes.load();
+}
+
+memory_usage memory_usage::now()
+{
+	memory_usage m;
+	m.allocations = num_allocations;
+	m.deallocations = num_deallocations;
+	m.allocated_bytes = num_allocated_bytes;
+	m.live_bytes = num_live_bytes;
+	m.peak_live_bytes = num_peak_live_bytes;
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc;
+	GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+	m.rss = pmc.WorkingSetSize;
+	m.peak_rss = pmc.PeakWorkingSetSize;
+#else
+#if defined(__linux__)
+	// The second field of statm is the number of resident pages.
+	size_t size = 0, resident = 0;
+	ifstream statm("/proc/self/statm");
+	statm >> size >> resident;
+	m.rss = resident * sysconf(_SC_PAGESIZE);
+#else
+	m.rss = 0; // There is no /proc/self/statm to read the current resident set size from.
+#endif
+	// ru_maxrss is in bytes on macOS, and in kilobytes on Linux and FreeBSD.
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	m.peak_rss = static_cast<size_t>(usage.ru_maxrss);
+#else
+	m.peak_rss = static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	return m;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#ifndef IGROW_TELEMETRY_HPP
+#define IGROW_TELEMETRY_HPP
+
+#include <cstdint>
+using namespace std;
+
+//! Represents a snapshot of the counters of the global allocator and the resident set size of the process.
+//! The global operator new and delete are replaced to count allocations, but counting only starts once enabled, so that it costs nothing unless telemetry is requested.
+class memory_usage
+{
+public:
+	size_t allocations; //!< Cumulative number of allocations since counting was enabled.
+	size_t deallocations; //!< Cumulative number of deallocations since counting was enabled.
+	size_t allocated_bytes; //!< Cumulative number of bytes allocated since counting was enabled.
+	int64_t live_bytes; //!< Number of bytes allocated minus the number of bytes deallocated since counting was enabled. Memory allocated before and freed after enabling makes it an underestimate.
+	int64_t peak_live_bytes; //!< Maximum of live_bytes since the peak was last reset.
+	size_t rss; //!< Current resident set size in bytes, or 0 where there is no /proc, e.g. on macOS and FreeBSD.
+	size_t peak_rss; //!< Peak resident set size of the process in bytes.
+
+	//! Starts counting the allocations of the global allocator.
+	static void enable();
+
+	//! Resets the peak of live bytes to the current live bytes, so that the peak of a phase can be measured.
+	static void reset_peak();
+
+	//! Takes a snapshot of the counters and the resident set size.
+	static memory_usage now();
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "lineage.hpp"
+
+//! Prints a node of a lineage store in csv format.
+static void print(lineage_reader& r, const uint32_t id)
+{
+	const lineage_node& n = r.nodes[id];
+	cout << id << ',' << n.generation << ',' << (n.kind == lineage_node::fragment_kind ? "fragment" : "ligand") << ',' << n.fe << ',' << r.name(id) << '\n';
+}
+
+//! Returns the identities of the ligands reachable from a ligand through its parent edges, including itself, in ascending order.
+static vector<uint32_t> ancestors(const lineage_reader& r, const uint32_t id)
+{
+	vector<bool> visited(r.nodes.size());
+	vector<uint32_t> stack(1, id), result;
+	visited[id] = true;
+	while (!stack.empty())
+	{
+		const uint32_t i = stack.back();
+		stack.pop_back();
+		result.push_back(i);
+		for (const uint32_t p : { r.nodes[i].parent1, r.nodes[i].parent2 })
+		{
+			if (p == lineage_node::none || visited[p]) continue;
+			visited[p] = true;
+			stack.push_back(p);
+		}
+	}
+	sort(result.begin(), result.end());
+	return result;
+}
+
+//! Answers ancestry, descendant and fragment usage queries on a lineage store written by igrow.
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		cout << "Usage: igrow-lineage <store> ancestors <ligand>" << endl;
+		cout << "       igrow-lineage <store> descendants <ligand>" << endl;
+		cout << "       igrow-lineage <store> fragments [ligand]" << endl;
+		cout << "Lists the ancestors or the descendants of a ligand, given by its path as in the log or by its identity, as id,generation,kind,free energy,path lines." << endl;
+		cout << "Lists the fragments used by all the ligands, or by the ancestors of a ligand, as count,id,path lines in descending order of count." << endl;
+		return 0;
+	}
+
+	try
+	{
+		lineage_reader r(argv[1]);
+		const string query = argv[2];
+
+		// Resolve the ligand by path, or by identity if no such path is recorded.
+		uint32_t id = lineage_node::none;
+		if (argc > 3)
+		{
+			const string name = argv[3];
+			id = r.find(name);
+			if (id == lineage_node::none && !name.empty() && all_of(name.cbegin(), name.cend(), ::isdigit) && stoul(name) < r.nodes.size()) id = static_cast<uint32_t>(stoul(name));
+			if (id == lineage_node::none || r.nodes[id].kind != lineage_node::ligand_kind)
+			{
+				cerr << "Ligand " << name << " does not exist in lineage store " << argv[1] << endl;
+				return 1;
+			}
+		}
+		else if (query != "fragments")
+		{
+			cerr << "Query " << query << " requires a ligand" << endl;
+			return 1;
+		}
+		cout.setf(ios::fixed, ios::floatfield);
+		cout << setprecision(3);
+
+		if (query == "ancestors")
+		{
+			for (const uint32_t i : ancestors(r, id))
+			{
+				print(r, i);
+			}
+		}
+		else if (query == "descendants")
+		{
+			// Children always follow their parents in the store, so one ascending sweep marks all the descendants.
+			const size_t n = r.nodes.size();
+			vector<bool> descendant(n);
+			descendant[id] = true;
+			for (size_t i = id + 1; i < n; ++i)
+			{
+				const lineage_node& c = r.nodes[i];
+				if ((c.parent1 != lineage_node::none && descendant[c.parent1]) || (c.parent2 != lineage_node::none && descendant[c.parent2])) descendant[i] = true;
+			}
+			for (size_t i = id; i < n; ++i)
+			{
+				if (descendant[i]) print(r, static_cast<uint32_t>(i));
+			}
+		}
+		else if (query == "fragments")
+		{
+			// Count the uses of every fragment by the given ligands.
+			vector<size_t> counts(r.nodes.size());
+			const auto count = [&](const uint32_t i)
+			{
+				if (r.nodes[i].fragment != lineage_node::none) ++counts[r.nodes[i].fragment];
+			};
+			if (id == lineage_node::none)
+			{
+				for (uint32_t i = 0; i < r.nodes.size(); ++i)
+				{
+					count(i);
+				}
+			}
+			else
+			{
+				for (const uint32_t i : ancestors(r, id))
+				{
+					count(i);
+				}
+			}
+			vector<uint32_t> used;
+			for (uint32_t i = 0; i < counts.size(); ++i)
+			{
+				if (counts[i]) used.push_back(i);
+			}
+			stable_sort(used.begin(), used.end(), [&](const uint32_t i0, const uint32_t i1)
+			{
+				return counts[i0] > counts[i1];
+			});
+			for (const uint32_t i : used)
+			{
+				cout << counts[i] << ',' << i << ',' << r.name(i) << '\n';
+			}
+		}
+		else
+		{
+			cerr << "Unknown query " << query << endl;
+			return 1;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+}
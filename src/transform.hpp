@@ -0,0 +1,100 @@
+#pragma once
+#ifndef IGROW_TRANSFORM_HPP
+#define IGROW_TRANSFORM_HPP
+
+#include <vector>
+#include <array>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+//! Represents a block of 3D coordinates in structure-of-arrays layout, suitable for batched arithmetic.
+class soa_coordinates
+{
+public:
+	vector<double> x; //!< x coordinates.
+	vector<double> y; //!< y coordinates.
+	vector<double> z; //!< z coordinates.
+
+	//! Constructs a block of n coordinates.
+	explicit soa_coordinates(const size_t n) : x(n), y(n), z(n) {}
+
+	//! Returns the number of coordinates.
+	size_t size() const
+	{
+		return x.size();
+	}
+
+	//! Sets the i-th coordinate.
+	void set(const size_t i, const array<double, 3>& v)
+	{
+		x[i] = v[0];
+		y[i] = v[1];
+		z[i] = v[2];
+	}
+
+	//! Gets the i-th coordinate.
+	array<double, 3> get(const size_t i) const
+	{
+		return { x[i], y[i], z[i] };
+	}
+};
+
+//! Applies the rigid-body transformation r * (v - c) + t to a range [b, e) of coordinates without vectorization.
+inline void transform_scalar(const soa_coordinates& in, soa_coordinates& out, const array<double, 9>& r, const array<double, 3>& c, const array<double, 3>& t, const size_t b, const size_t e)
+{
+	for (size_t i = b; i < e; ++i)
+	{
+		const double dx = in.x[i] - c[0];
+		const double dy = in.y[i] - c[1];
+		const double dz = in.z[i] - c[2];
+		out.x[i] = r[0] * dx + r[1] * dy + r[2] * dz + t[0];
+		out.y[i] = r[3] * dx + r[4] * dy + r[5] * dz + t[1];
+		out.z[i] = r[6] * dx + r[7] * dy + r[8] * dz + t[2];
+	}
+}
+
+//! Applies the rigid-body transformation r * (v - c) + t to a whole block of coordinates, vectorized with AVX or SSE2 when available.
+//! The operations are performed in the same order as transform_scalar() and operator*(array<double, 9>, array<double, 3>) without fused multiply-add, so the results are bitwise identical as long as the compiler does not contract them either, hence -ffp-contract=off in the Makefile. make test checks this.
+inline void transform(const soa_coordinates& in, soa_coordinates& out, const array<double, 9>& r, const array<double, 3>& c, const array<double, 3>& t)
+{
+	const size_t n = in.size();
+	size_t i = 0;
+#if defined(__AVX__)
+	const __m256d cx = _mm256_set1_pd(c[0]), cy = _mm256_set1_pd(c[1]), cz = _mm256_set1_pd(c[2]);
+	const __m256d tx = _mm256_set1_pd(t[0]), ty = _mm256_set1_pd(t[1]), tz = _mm256_set1_pd(t[2]);
+	const __m256d r0 = _mm256_set1_pd(r[0]), r1 = _mm256_set1_pd(r[1]), r2 = _mm256_set1_pd(r[2]);
+	const __m256d r3 = _mm256_set1_pd(r[3]), r4 = _mm256_set1_pd(r[4]), r5 = _mm256_set1_pd(r[5]);
+	const __m256d r6 = _mm256_set1_pd(r[6]), r7 = _mm256_set1_pd(r[7]), r8 = _mm256_set1_pd(r[8]);
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&in.x[i]), cx);
+		const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&in.y[i]), cy);
+		const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(&in.z[i]), cz);
+		_mm256_storeu_pd(&out.x[i], _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r0, dx), _mm256_mul_pd(r1, dy)), _mm256_mul_pd(r2, dz)), tx));
+		_mm256_storeu_pd(&out.y[i], _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r3, dx), _mm256_mul_pd(r4, dy)), _mm256_mul_pd(r5, dz)), ty));
+		_mm256_storeu_pd(&out.z[i], _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r6, dx), _mm256_mul_pd(r7, dy)), _mm256_mul_pd(r8, dz)), tz));
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	const __m128d cx = _mm_set1_pd(c[0]), cy = _mm_set1_pd(c[1]), cz = _mm_set1_pd(c[2]);
+	const __m128d tx = _mm_set1_pd(t[0]), ty = _mm_set1_pd(t[1]), tz = _mm_set1_pd(t[2]);
+	const __m128d r0 = _mm_set1_pd(r[0]), r1 = _mm_set1_pd(r[1]), r2 = _mm_set1_pd(r[2]);
+	const __m128d r3 = _mm_set1_pd(r[3]), r4 = _mm_set1_pd(r[4]), r5 = _mm_set1_pd(r[5]);
+	const __m128d r6 = _mm_set1_pd(r[6]), r7 = _mm_set1_pd(r[7]), r8 = _mm_set1_pd(r[8]);
+	for (; i + 2 <= n; i += 2)
+	{
+		const __m128d dx = _mm_sub_pd(_mm_loadu_pd(&in.x[i]), cx);
+		const __m128d dy = _mm_sub_pd(_mm_loadu_pd(&in.y[i]), cy);
+		const __m128d dz = _mm_sub_pd(_mm_loadu_pd(&in.z[i]), cz);
+		_mm_storeu_pd(&out.x[i], _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(r0, dx), _mm_mul_pd(r1, dy)), _mm_mul_pd(r2, dz)), tx));
+		_mm_storeu_pd(&out.y[i], _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(r3, dx), _mm_mul_pd(r4, dy)), _mm_mul_pd(r5, dz)), ty));
+		_mm_storeu_pd(&out.z[i], _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(r6, dx), _mm_mul_pd(r7, dy)), _mm_mul_pd(r8, dz)), tz));
+	}
+#endif
+	transform_scalar(in, out, r, c, t, i, n);
+}
+
+#endif
@@ -0,0 +1,62 @@
+#include <cstring>
+#include <random>
+#include <iostream>
+#include "../src/array.hpp"
+#include "../src/transform.hpp"
+
+void transform_reference(const soa_coordinates& in, soa_coordinates& out, const array<double, 9>& r, const array<double, 3>& c, const array<double, 3>& t);
+void transform_scalar_reference(const soa_coordinates& in, soa_coordinates& out, const array<double, 9>& r, const array<double, 3>& c, const array<double, 3>& t);
+
+//! Returns true if two blocks of coordinates are bitwise identical.
+static bool identical(const soa_coordinates& a, const soa_coordinates& b)
+{
+	const size_t bytes = sizeof(double) * a.size();
+	return !a.size() || (!memcmp(a.x.data(), b.x.data(), bytes) && !memcmp(a.y.data(), b.y.data(), bytes) && !memcmp(a.z.data(), b.z.data(), bytes));
+}
+
+//! Checks that the vectorized transform() is bitwise identical to the scalar references on random rigid-body transformations of random blocks, including their tails.
+int main()
+{
+#if defined(__AVX__)
+	const char* const isa = "AVX";
+#if defined(__GNUC__)
+	if (!__builtin_cpu_supports("avx"))
+	{
+		cout << "Skipping the AVX transform test on a CPU without AVX" << endl;
+		return 0;
+	}
+#endif
+#elif defined(__SSE2__) || defined(_M_X64)
+	const char* const isa = "SSE2";
+#else
+	const char* const isa = "scalar";
+#endif
+	mt19937_64 eng(0);
+	uniform_real_distribution<double> uniform_coordinate(-50, 50), uniform_cosine(-1, 1);
+	size_t num_mismatches = 0, num_frames = 0;
+	for (size_t n = 0; n <= 37; ++n)
+	for (size_t k = 0; k < 200; ++k, ++num_frames)
+	{
+		// Draw a random rotation about a random axis, a random origin and a random translation.
+		const array<double, 3> axis = normalize(array<double, 3>{ uniform_coordinate(eng), uniform_coordinate(eng), uniform_coordinate(eng) });
+		const array<double, 9> r = vec3_to_mat3(axis, uniform_cosine(eng));
+		const array<double, 3> c = { uniform_coordinate(eng), uniform_coordinate(eng), uniform_coordinate(eng) };
+		const array<double, 3> t = { uniform_coordinate(eng), uniform_coordinate(eng), uniform_coordinate(eng) };
+		soa_coordinates in(n), out(n), expected(n), expected_scalar(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			in.set(i, { uniform_coordinate(eng), uniform_coordinate(eng), uniform_coordinate(eng) });
+		}
+		transform(in, out, r, c, t);
+		transform_reference(in, expected, r, c, t);
+		transform_scalar_reference(in, expected_scalar, r, c, t);
+		if (!identical(out, expected) || !identical(out, expected_scalar)) ++num_mismatches;
+	}
+	if (num_mismatches)
+	{
+		cerr << isa << " transform differs from the scalar reference in " << num_mismatches << " of " << num_frames << " frames" << endl;
+		return 1;
+	}
+	cout << isa << " transform is bitwise identical to the scalar reference in " << num_frames << " frames" << endl;
+	return 0;
+}
@@ -0,0 +1,17 @@
+#include "../src/array.hpp"
+#include "../src/transform.hpp"
+
+//! Applies the rigid-body transformation one coordinate at a time by the scalar operators of array.hpp, compiled without floating-point contraction as the reference of transform().
+void transform_reference(const soa_coordinates& in, soa_coordinates& out, const array<double, 9>& r, const array<double, 3>& c, const array<double, 3>& t)
+{
+	for (size_t i = 0; i < in.size(); ++i)
+	{
+		out.set(i, r * (in.get(i) - c) + t);
+	}
+}
+
+//! Applies transform_scalar() to a whole block, compiled without floating-point contraction.
+void transform_scalar_reference(const soa_coordinates& in, soa_coordinates& out, const array<double, 9>& r, const array<double, 3>& c, const array<double, 3>& t)
+{
+	transform_scalar(in, out, r, c, t, 0, in.size());
+}